@@ -0,0 +1,190 @@
+#include "main.h"
+
+#include "ecdsa.h"
+#include "secp256k1.h"
+#include "curves.h"
+#include "sha2.h"
+#include "hmac.h"
+#include "base58.h"
+#include "transaction.h"
+
+#if (CONSOLE!=0)
+
+/*
+ *  On-device benchmark of the trezor-crypto primitives.
+ *
+ *  Every primitive is run for a fixed number of iterations and timed with
+ *  the RTC1 counter (4096 Hz). Results go out on the console as a single
+ *  JSON object, one entry per primitive, so the output of "bench" can be
+ *  captured from the UART and compared between builds.
+ *
+ *  The command runs in the UART interrupt, so nothing here may touch the
+ *  bip32 caches that the main context uses; the hdnode_* timings come from
+ *  the host build (tools/bench_host) only.
+ */
+
+#define BENCH_CPU_HZ    16000000UL
+#define BENCH_RTC_HZ    4096UL
+
+typedef void (*bench_proc)(void);
+
+struct bench_entry {
+	const char *name;
+	u16 iters;
+	bench_proc proc;
+};
+
+static const uint8_t bench_privkey[32] = {
+	0xcc, 0xa9, 0xfb, 0xcc, 0x1b, 0x41, 0xe5, 0xa9, 0x5d, 0x36, 0x9e, 0xaa, 0x6d, 0xdc, 0xff, 0x73,
+	0xb6, 0x1a, 0x4e, 0xfa, 0xa2, 0x79, 0xcf, 0xc6, 0x56, 0x7e, 0x8d, 0xaa, 0x39, 0xcb, 0xaf, 0x50
+};
+
+static uint8_t bench_digest[32];
+static uint8_t bench_pubkey[65];
+static uint8_t bench_sig[64];
+static uint8_t bench_recid;
+static uint8_t bench_out[65];
+static char bench_str[MAX_ADDR_SIZE];
+static curve_point bench_point, bench_res;
+static bignum256 bench_k, bench_inv;
+
+static void bench_ecdsa_sign_digest(void)
+{
+	ecdsa_sign_digest(&secp256k1, bench_privkey, bench_digest, bench_out, NULL, NULL);
+}
+
+static void bench_ecdsa_verify_digest(void)
+{
+	ecdsa_verify_digest(&secp256k1, bench_pubkey, bench_sig, bench_digest);
+}
+
+static void bench_ecdsa_verify_digest_recover(void)
+{
+	ecdsa_verify_digest_recover(&secp256k1, bench_out, bench_sig, bench_digest, bench_recid);
+}
+
+static void bench_ecdsa_get_public_key33(void)
+{
+	ecdsa_get_public_key33(&secp256k1, bench_privkey, bench_out);
+}
+
+static void bench_point_multiply(void)
+{
+	point_multiply(&secp256k1, &bench_k, &bench_point, &bench_res);
+}
+
+static void bench_scalar_multiply(void)
+{
+	scalar_multiply(&secp256k1, &bench_k, &bench_res);
+}
+
+static void bench_bn_inverse(void)
+{
+	bench_inv = bench_k;
+	bn_inverse(&bench_inv, &secp256k1.prime);
+}
+
+static void bench_sha256_raw(void)
+{
+	sha256_Raw(bench_pubkey, sizeof(bench_pubkey), bench_out);
+}
+
+static void bench_sha512_raw(void)
+{
+	sha512_Raw(bench_pubkey, sizeof(bench_pubkey), bench_out);
+}
+
+static void bench_ecdsa_get_pubkeyhash(void)
+{
+	ecdsa_get_pubkeyhash(bench_pubkey, bench_out);
+}
+
+static void bench_tx_hash_final(void)
+{
+	TxStruct tx;
+	tx_init(&tx, 1, 1, 1, 0, 0, false);
+	sha256_Update(&(tx.ctx), bench_pubkey, sizeof(bench_pubkey));
+	tx_hash_final(&tx, bench_out, true);
+}
+
+static void bench_hmac_sha256(void)
+{
+	hmac_sha256(bench_digest, 32, bench_pubkey, 37, bench_out);
+}
+
+static void bench_hmac_sha512(void)
+{
+	hmac_sha512(bench_digest, 32, bench_pubkey, 37, bench_out);
+}
+
+static void bench_base58_encode_check(void)
+{
+	base58_encode_check(bench_pubkey, 21, bench_str, sizeof(bench_str));
+}
+
+static const struct bench_entry bench_list[] = {
+	{ "ecdsa_sign_digest",            4, bench_ecdsa_sign_digest },
+	{ "ecdsa_verify_digest",          4, bench_ecdsa_verify_digest },
+	{ "ecdsa_verify_digest_recover",  4, bench_ecdsa_verify_digest_recover },
+	{ "ecdsa_get_public_key33",       4, bench_ecdsa_get_public_key33 },
+	{ "point_multiply",               4, bench_point_multiply },
+	{ "scalar_multiply",              4, bench_scalar_multiply },
+	{ "bn_inverse",                  64, bench_bn_inverse },
+	{ "sha256_Raw",                 256, bench_sha256_raw },
+	{ "tx_hash_final",              128, bench_tx_hash_final },
+	{ "sha512_Raw",                  64, bench_sha512_raw },
+	{ "ecdsa_get_pubkeyhash",       256, bench_ecdsa_get_pubkeyhash },
+	{ "hmac_sha256",                128, bench_hmac_sha256 },
+	{ "hmac_sha512",                 64, bench_hmac_sha512 },
+	{ "base58_encode_check",         64, bench_base58_encode_check },
+};
+
+static void bench_setup(void)
+{
+	sha256_Raw((const uint8_t *)"Hideez", 6, bench_digest);
+	ecdsa_get_public_key33(&secp256k1, bench_privkey, bench_pubkey);
+	ecdsa_sign_digest(&secp256k1, bench_privkey, bench_digest, bench_sig, &bench_recid, NULL);
+	bn_read_be(bench_digest, &bench_k);
+	point_copy(&secp256k1.G, &bench_point);
+}
+
+static int bench_match(const char *filter, const char *name)
+{
+	while (*filter > ' ') {
+		if (*filter++ != *name++) return 0;
+	}
+	return 1;
+}
+
+/*
+ *  Run all benchmarks whose name starts with the given filter
+ *  (empty filter runs everything)
+ */
+void bench_run(const char *filter)
+{
+	const struct bench_entry *b;
+	u32 t0, ticks, i, n = 0;
+
+	bench_setup();
+	console_direct(true);
+	dprintf("{\"cpu_hz\":%d,\"rtc_hz\":%d,\"bench\":[", BENCH_CPU_HZ, BENCH_RTC_HZ);
+	for (b = bench_list; b < bench_list + sizeof(bench_list)/sizeof(bench_list[0]); b++) {
+		if (! bench_match(filter, b->name)) continue;
+		t0 = JIFFIES;
+		for (i = 0; i < b->iters; i++) {
+			b->proc();
+		}
+		ticks = TIMEDIFF(JIFFIES, t0);
+		if (ticks == 0) ticks = 1;
+		dprintf("%s\n{\"name\":\"%s\",\"iters\":%d,\"ticks\":%d,\"us_per_op\":%d,\"cycles_per_op\":%d,\"ops_per_sec_x100\":%d}",
+			n++ ? "," : "", b->name, b->iters, ticks,
+			(u32)((u64)ticks * 1000000 / BENCH_RTC_HZ / b->iters),
+			(u32)((u64)ticks * BENCH_CPU_HZ / BENCH_RTC_HZ / b->iters),
+			(u32)((u64)b->iters * BENCH_RTC_HZ * 100 / ticks));
+	}
+	dprintf("\n]}\n");
+	console_direct(false);
+	memset(bench_out, 0, sizeof(bench_out));
+}
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#if (CONSOLE!=0)
+
+void bench_run(const char *filter);
+
+#endif
+
+#endif
@@ -245,6 +245,28 @@ static const ble_gatts_attr_t out_reportref_desc_value = {
 	.max_len = 2,
 };
 
+static const ble_uuid128_t stream_base_uuid = { BLE_UUID_STREAM_BASE };
+// .type is filled in by ble_init() once the base is registered
+static ble_uuid_t stream_service_uuid = { BLE_UUID_STREAM_SERVICE, BLE_UUID_TYPE_UNKNOWN };
+static ble_uuid_t stream_rx_uuid = { BLE_UUID_STREAM_RX, BLE_UUID_TYPE_UNKNOWN };
+static ble_uuid_t stream_tx_uuid = { BLE_UUID_STREAM_TX, BLE_UUID_TYPE_UNKNOWN };
+
+static const ble_gatts_attr_t stream_rx_char_value = {
+	.p_uuid = &stream_rx_uuid,
+	.p_attr_md = (ble_gatts_attr_md_t *) &attr_stack_md,
+	.init_len = 0,
+	.init_offs = 0,
+	.max_len = BLE_STREAM_MAX_DATA_LEN,
+};
+
+static const ble_gatts_attr_t stream_tx_char_value = {
+	.p_uuid = &stream_tx_uuid,
+	.p_attr_md = (ble_gatts_attr_md_t *) &attr_stack_md,
+	.init_len = 0,
+	.init_offs = 0,
+	.max_len = BLE_STREAM_MAX_DATA_LEN,
+};
+
 static const uint8_t adv_data[] = {
 	2, BLE_GAP_AD_TYPE_FLAGS,BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE,
 	3, BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE,
@@ -282,7 +304,7 @@ static const ble_gap_sec_params_t m_sec_params = {
 	.kdist_periph.enc = 1,
 };
 
-__align(4) u8  gs_evt_buf[(sizeof(ble_evt_t) + BLE_L2CAP_MTU_DEF + 3) & ~3];
+__align(4) u8  gs_evt_buf[(sizeof(ble_evt_t) + BLE_ATT_MTU_MAX + 3) & ~3];
 
 static bool connected = false;
 
@@ -293,10 +315,26 @@ uint16_t conn_handle = BLE_CONN_HANDLE_INVALID;
 uint16_t btdis_service_handle;
 uint16_t battery_service_handle;
 uint16_t hid_service_handle;
+uint16_t stream_service_handle;
 
 ble_gatts_char_handles_t hid_cp_handles;
 ble_gatts_char_handles_t hid_rx_handles;
 ble_gatts_char_handles_t hid_tx_handles;
+ble_gatts_char_handles_t stream_rx_handles;
+ble_gatts_char_handles_t stream_tx_handles;
+
+static u16 att_mtu = GATT_MTU_SIZE_DEFAULT;
+
+typedef struct {
+	u16 handle;
+	u16 len;
+	u8  data[BLE_TX_PACKET_LEN];
+} ble_tx_packet_t;
+
+static ble_tx_packet_t tx_queue[BLE_TX_QUEUE_SIZE];
+static u8 tx_head = 0;
+static u8 tx_count = 0;
+static uint32_t tx_status = NRF_SUCCESS;
 
 ble_gap_enc_key_t         m_enc_key;    //24b could be changed with pointer to dummy.
 ble_gap_id_key_t 					m_peer_id;   		/**< IRK and/or address of peer. */
@@ -363,6 +401,17 @@ void ble_init(void)
 	sd_ble_gatts_descriptor_add(BLE_GATT_HANDLE_INVALID, &out_reportref_desc_value, (uint16_t *)&dhandle); // host -> device (write)
 	DBG("HID: CP=%4x TX=%4x RX=%4x CCCD=%4x\n", hid_cp_handles.value_handle, hid_tx_handles.value_handle, hid_rx_handles.value_handle, hid_rx_handles.cccd_handle);
 
+	// Adding stream service: same protocol as HID, without report framing
+
+	u8 uuid_type;
+	ret = sd_ble_uuid_vs_add(&stream_base_uuid, &uuid_type);
+	if (ret != NRF_SUCCESS) dprintf("sd_ble_uuid_vs_add: %x\n", ret);
+	stream_service_uuid.type = stream_rx_uuid.type = stream_tx_uuid.type = uuid_type;
+	sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &stream_service_uuid, &stream_service_handle);
+	sd_ble_gatts_characteristic_add(stream_service_handle, &rx_char_md, &stream_rx_char_value, &stream_rx_handles);  // device -> host (notify)
+	sd_ble_gatts_characteristic_add(stream_service_handle, &tx_char_md, &stream_tx_char_value, &stream_tx_handles);  // host -> device (write)
+	DBG("STREAM: TX=%4x RX=%4x CCCD=%4x\n", stream_tx_handles.value_handle, stream_rx_handles.value_handle, stream_rx_handles.cccd_handle);
+
 	BLE_GAP_CONN_SEC_MODE_SET_OPEN(&sec_mode);
 	sd_ble_gap_device_name_set(&sec_mode,(const uint8_t *)DeviceName, sizeof(DeviceName));
 	restart_advertising();
@@ -391,6 +440,19 @@ static void restore_context(u16 handle, u8 *addr)
 	sd_ble_gatts_sys_attr_set(handle, sys_attr_buffer, sys_attr_len, BLE_GATTS_SYS_ATTR_FLAG_SYS_SRVCS | BLE_GATTS_SYS_ATTR_FLAG_USR_SRVCS);
 }
 
+// hand queued notifications to the SoftDevice until it runs out of TX buffers
+static void ble_tx_drain(void)
+{
+	while (tx_count) {
+		ble_tx_packet_t *p = &tx_queue[tx_head];
+		uint32_t ret = ble_notification(p->handle, p->data, p->len);
+		if (ret == BLE_ERROR_NO_TX_BUFFERS || ret == NRF_ERROR_BUSY) return;
+		if (ret != NRF_SUCCESS) tx_status = ret;
+		tx_head = (tx_head + 1) % BLE_TX_QUEUE_SIZE;
+		tx_count--;
+	}
+}
+
 static void handle_event(ble_evt_t *ble_evt)
 {
 	u16 evt_id = ble_evt->header.evt_id;
@@ -401,6 +463,8 @@ static void handle_event(ble_evt_t *ble_evt)
 		DBG("Connect\n");
 		conn_handle = ble_evt->evt.gap_evt.conn_handle;
 		restore_context(conn_handle);
+		att_mtu = GATT_MTU_SIZE_DEFAULT;
+		tx_status = NRF_SUCCESS;
 		connected = true;
 	}
 	else if (evt_id == BLE_GAP_EVT_DISCONNECTED)
@@ -409,6 +473,8 @@ static void handle_event(ble_evt_t *ble_evt)
 		DBG("Disconnect %2x\n",reason);
 		save_context(conn_handle);
 		conn_handle = BLE_CONN_HANDLE_INVALID;
+		tx_count = 0;
+		tx_status = NRF_SUCCESS;
 		restart_advertising();
 		connected = false;
 	}
@@ -416,6 +482,10 @@ static void handle_event(ble_evt_t *ble_evt)
 	{
 		restart_advertising();
 	}
+	else if (evt_id == BLE_EVT_TX_COMPLETE)
+	{
+		ble_tx_drain();
+	}
 	else if (evt_id == BLE_GATTS_EVT_WRITE)
 	{
 		ble_gatts_evt_write_t *evt_write = &ble_evt->evt.gatts_evt.params.write;
@@ -424,8 +494,20 @@ static void handle_event(ble_evt_t *ble_evt)
 		//DBG("WriteReq %x len=%d\n", evt_write->handle, len);
 		if (evt_write->handle == hid_tx_handles.value_handle) {
 			hid_message_receive(data, len);
+		} else if (evt_write->handle == stream_tx_handles.value_handle) {
+			stream_message_receive(data, len);
 		}
 	}
+#if BLE_ATT_MTU_MAX > GATT_MTU_SIZE_DEFAULT
+	else if (evt_id == BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST)
+	{
+		u16 client_mtu = ble_evt->evt.gatts_evt.params.exchange_mtu_request.client_rx_mtu;
+		att_mtu = (client_mtu < BLE_ATT_MTU_MAX) ? client_mtu : BLE_ATT_MTU_MAX;
+		if (att_mtu < GATT_MTU_SIZE_DEFAULT) att_mtu = GATT_MTU_SIZE_DEFAULT;
+		sd_ble_gatts_exchange_mtu_reply(conn_handle, BLE_ATT_MTU_MAX);
+		DBG("MTU %d\n", att_mtu);
+	}
+#endif
 	else if (evt_id == BLE_GAP_EVT_SEC_PARAMS_REQUEST)
 	{
 		DBG("SecParamsReq\n");
@@ -495,5 +577,56 @@ uint32_t ble_notification(u16 handle, u8 *data, u16 length)
 	return sd_ble_gatts_hvx(conn_handle, &hvx_params);
 }
 
+// Starts a new message on the TX queue, errors of earlier packets are
+// not reported for it
+void ble_notification_begin(void)
+{
+	tx_status = NRF_SUCCESS;
+}
+
+// Copies the packet into the TX queue and returns without waiting for it
+// to go out; blocks only while the queue is full. Returns the first send
+// error since ble_notification_begin(), if any.
+uint32_t ble_notification_queue(u16 handle, u8 *data, u16 length)
+{
+	ble_tx_packet_t *p;
+	uint32_t t = JIFFIES;
+
+	if (length > BLE_TX_PACKET_LEN) return NRF_ERROR_INVALID_LENGTH;
+	while (tx_count == BLE_TX_QUEUE_SIZE) {
+		if (TIMEDIFF(JIFFIES, t) >= HID_IO_TIMEOUT) return NRF_ERROR_TIMEOUT;
+		ble_wait_event();
+	}
+	p = &tx_queue[(tx_head + tx_count) % BLE_TX_QUEUE_SIZE];
+	p->handle = handle;
+	p->len = length;
+	memcpy(p->data, data, length);
+	tx_count++;
+	ble_tx_drain();
+	return tx_status;
+}
+
+// Waits until the queued packets are handed to the SoftDevice and returns
+// the result of the message, packets dropped by a disconnect count as
+// failed
+uint32_t ble_notification_flush(void)
+{
+	uint32_t ret;
+	uint32_t t = JIFFIES;
+
+	while (tx_count) {
+		if (TIMEDIFF(JIFFIES, t) >= HID_IO_TIMEOUT) return NRF_ERROR_TIMEOUT;
+		ble_wait_event();
+	}
+	ret = connected ? tx_status : BLE_ERROR_INVALID_CONN_HANDLE;
+	tx_status = NRF_SUCCESS;
+	return ret;
+}
+
+u16 ble_stream_data_len(void)
+{
+	return att_mtu - 3;  // ATT opcode and handle
+}
+
 bool ble_is_connected(void) { return connected; }
 
@@ -26,6 +26,26 @@
 #define BLE_UUID_BATTERY_SERVICE          0x180f
 #define BLE_UUID_HID_SERVICE              0x1812
 
+// vendor specific stream service, 16-bit values inside BLE_UUID_STREAM_BASE
+#define BLE_UUID_STREAM_BASE              { 0x1b, 0xc5, 0xd5, 0xa5, 0x02, 0x00, 0x6f, 0xa8, 0xe4, 0x11, 0x9a, 0x3b, 0x00, 0x00, 0xde, 0x1d }
+#define BLE_UUID_STREAM_SERVICE           0x0001
+#define BLE_UUID_STREAM_RX                0x0002
+#define BLE_UUID_STREAM_TX                0x0003
+
+// largest ATT MTU accepted in the exchange; GATT_MTU_SIZE_DEFAULT disables the exchange
+#ifndef BLE_ATT_MTU_MAX
+#define BLE_ATT_MTU_MAX                   GATT_MTU_SIZE_DEFAULT
+#endif
+#define BLE_STREAM_MAX_DATA_LEN           (BLE_ATT_MTU_MAX - 3)
+
+// outgoing notifications waiting for a SoftDevice TX buffer
+#define BLE_TX_QUEUE_SIZE                 6
+#if BLE_STREAM_MAX_DATA_LEN > BLE_MAX_DATA_LEN
+#define BLE_TX_PACKET_LEN                 BLE_STREAM_MAX_DATA_LEN
+#else
+#define BLE_TX_PACKET_LEN                 BLE_MAX_DATA_LEN
+#endif
+
 #define APP_ADV_INTERVAL                  MSEC_TO_UNITS(100, 625)   /* The advertising interval (in units of 0.625 ms. */
 #define APP_ADV_TIMEOUT_IN_SECONDS        3000
 
@@ -45,14 +65,21 @@ extern uint16_t conn_handle;
 extern ble_gatts_char_handles_t hid_cp_handles;
 extern ble_gatts_char_handles_t hid_rx_handles;
 extern ble_gatts_char_handles_t hid_tx_handles;
+extern ble_gatts_char_handles_t stream_rx_handles;
+extern ble_gatts_char_handles_t stream_tx_handles;
 
 void     ble_init(void);
 bool ble_is_connected(void);
 uint32_t ble_check_event(void);
 uint32_t ble_wait_event(void);
 uint32_t ble_notification(u16 handle, u8 *data, u16 length);
+void     ble_notification_begin(void);
+uint32_t ble_notification_queue(u16 handle, u8 *data, u16 length);
+uint32_t ble_notification_flush(void);
+u16 ble_stream_data_len(void);
 
 
 void hid_message_receive(uint8_t *data, int len);
+void stream_message_receive(uint8_t *data, int len);
 
 #endif
@@ -214,13 +214,55 @@ uint8_t *cryptoHDNodePathToPubkey(const HDNodePathType *hdnodepath)
 	return node.public_key;
 }
 
+// number of cosigner keys derived together, see hdnode_public_ckd_batch
+#define MULTISIG_BATCH 4
+
 int cryptoMultisigPubkeyIndex(const MultisigRedeemScriptType *multisig, const uint8_t *pubkey)
 {
 	#ifdef SUPPORT_EXTENDED_TYPES
-	for (size_t i = 0; i < multisig->pubkeys_count; i++) {
-		const uint8_t *node_pubkey = cryptoHDNodePathToPubkey(&(multisig->pubkeys[i]));
-		if (node_pubkey && memcmp(node_pubkey, pubkey, 33) == 0) {
-			return i;
+	static HDNode nodes[MULTISIG_BATCH];
+	HDNode *batch[MULTISIG_BATCH];
+	uint32_t index[MULTISIG_BATCH];
+	int valid[MULTISIG_BATCH];
+	const HDNodePathType *path;
+	size_t cnt, k, m, depth, maxdepth;
+
+	for (size_t i = 0; i < multisig->pubkeys_count; i += cnt) {
+		cnt = multisig->pubkeys_count - i;
+		if (cnt > MULTISIG_BATCH) cnt = MULTISIG_BATCH;
+		maxdepth = 0;
+		for (k = 0; k < cnt; k++) {
+			path = &(multisig->pubkeys[i + k]);
+			valid[k] = path->node.has_public_key && path->node.public_key.size == 33 &&
+				hdnode_from_xpub(path->node.depth, path->node.child_num, path->node.chain_code.bytes, path->node.public_key.bytes, SECP256K1_NAME, &nodes[k]) != 0;
+			if (valid[k] && path->address_n_count > maxdepth) {
+				maxdepth = path->address_n_count;
+			}
+		}
+		// may take a long time, every step of the group shares one inversion
+		for (depth = 0; depth < maxdepth; depth++) {
+			m = 0;
+			for (k = 0; k < cnt; k++) {
+				path = &(multisig->pubkeys[i + k]);
+				if (valid[k] && depth < path->address_n_count) {
+					batch[m] = &nodes[k];
+					index[m] = path->address_n[depth];
+					m++;
+				}
+			}
+			hdnode_public_ckd_batch(batch, index, m);
+			// a node that could not be derived keeps its depth
+			for (k = 0; k < cnt; k++) {
+				path = &(multisig->pubkeys[i + k]);
+				if (valid[k] && depth < path->address_n_count && nodes[k].depth != path->node.depth + depth + 1) {
+					valid[k] = 0;
+				}
+			}
+		}
+		for (k = 0; k < cnt; k++) {
+			if (valid[k] && memcmp(nodes[k].public_key, pubkey, 33) == 0) {
+				return i + k;
+			}
 		}
 	}
 	#endif
@@ -177,7 +177,7 @@ static const CoinType *fsm_getCoin(bool has_name, const char *name)
 	return coin;
 }
 
-static HDNode *fsm_getDerivedNode(const char *curve, uint32_t *address_n, size_t address_n_count)
+static HDNode *fsm_getDerivedNode(const char *curve, uint32_t *address_n, size_t address_n_count, uint32_t *fingerprint)
 {
 	static HDNode node;
 	if (!storage_getRootNode(&node, curve)) {
@@ -185,10 +185,13 @@ static HDNode *fsm_getDerivedNode(const char *curve, uint32_t *address_n, size_t
 		dialogClear();
 		return 0;
 	}
+	if (fingerprint) {
+		*fingerprint = 0;
+	}
 	if (!address_n || address_n_count == 0) {
 		return &node;
 	}
-	if (hdnode_private_ckd_cached(&node, address_n, address_n_count, NULL) == 0) {
+	if (hdnode_private_ckd_cached(&node, address_n, address_n_count, fingerprint) == 0) {
 		fsm_sendFailure(FailureType_Failure_ProcessError, "Failed to derive private key");
 		dialogClear();
 		return 0;
@@ -196,6 +199,20 @@ static HDNode *fsm_getDerivedNode(const char *curve, uint32_t *address_n, size_t
 	return &node;
 }
 
+// like fsm_getDerivedNode for requests that only need the public key, the
+// last step is derived publicly and the private key of the node is cleared
+static HDNode *fsm_getDerivedPublicNode(const char *curve, uint32_t *address_n, size_t address_n_count)
+{
+	HDNode *node = fsm_getDerivedNode(curve, NULL, 0, NULL);
+	if (!node) return 0;
+	if (hdnode_public_ckd_cached(node, address_n, address_n_count) == 0) {
+		fsm_sendFailure(FailureType_Failure_ProcessError, "Failed to derive public key");
+		dialogClear();
+		return 0;
+	}
+	return node;
+}
+
 void fsm_msgInitialize(Initialize *msg)
 {
 	(void)msg;
@@ -361,19 +378,8 @@ void fsm_msgGetPublicKey(GetPublicKey *msg)
 		curve = msg->ecdsa_curve_name;
 	}
 	uint32_t fingerprint;
-	HDNode *node;
-	if (msg->address_n_count == 0) {
-		/* get master node */
-		fingerprint = 0;
-		node = fsm_getDerivedNode(curve, msg->address_n, 0);
-	} else {
-		/* get parent node */
-		node = fsm_getDerivedNode(curve, msg->address_n, msg->address_n_count - 1);
-		if (!node) return;
-		fingerprint = hdnode_fingerprint(node);
-		/* get child */
-		hdnode_private_ckd(node, msg->address_n[msg->address_n_count - 1]);
-	}
+	HDNode *node = fsm_getDerivedNode(curve, msg->address_n, msg->address_n_count, &fingerprint);
+	if (!node) return;
 	hdnode_fill_public_key(node);
 
 	//if (msg->has_show_display && msg->show_display) {
@@ -435,7 +441,7 @@ void fsm_msgSignTx(SignTx *msg)
 
 	const CoinType *coin = fsm_getCoin(msg->has_coin_name, msg->coin_name);
 	if (!coin) return;
-	const HDNode *node = fsm_getDerivedNode(SECP256K1_NAME, 0, 0);
+	const HDNode *node = fsm_getDerivedNode(SECP256K1_NAME, 0, 0, NULL);
 	if (!node) return;
 
 	signing_init(resp, msg->inputs_count, msg->outputs_count, coin, node, msg->version, msg->lock_time);
@@ -497,9 +503,8 @@ void fsm_msgGetAddress(GetAddress *msg)
 
 	const CoinType *coin = fsm_getCoin(msg->has_coin_name, msg->coin_name);
 	if (!coin) return;
-	HDNode *node = fsm_getDerivedNode(SECP256K1_NAME, msg->address_n, msg->address_n_count);
+	HDNode *node = fsm_getDerivedPublicNode(SECP256K1_NAME, msg->address_n, msg->address_n_count);
 	if (!node) return;
-	hdnode_fill_public_key(node);
 
 	char address[MAX_ADDR_SIZE];
 	dialogProgress("Computing address", 0);
@@ -533,6 +538,61 @@ void fsm_msgGetAddress(GetAddress *msg)
 	dialogClear();
 }
 
+// number of children derived together, see hdnode_public_ckd_batch
+#define ADDRESS_BATCH 4
+
+void fsm_msgGetAddresses(GetAddresses *msg)
+{
+	static HDNode nodes[ADDRESS_BATCH];
+	HDNode *batch[ADDRESS_BATCH];
+	uint32_t index[ADDRESS_BATCH];
+	uint32_t i, k, cnt;
+
+	RESP(GetAddresses, Addresses);
+
+	CHECK_INITIALIZED
+
+	const uint32_t start = msg->has_start_index ? msg->start_index : 0;
+	CHECK_PARAM(msg->count > 0 && msg->count <= sizeof(resp->address) / sizeof(resp->address[0]), "Invalid address count");
+	CHECK_PARAM(start < 0x80000000 && msg->count <= 0x80000000 - start, "Invalid start index");
+
+	if (! check_pin(true)) return;
+
+	const CoinType *coin = fsm_getCoin(msg->has_coin_name, msg->coin_name);
+	if (!coin) return;
+	HDNode *node = fsm_getDerivedPublicNode(SECP256K1_NAME, msg->address_n, msg->address_n_count);
+	if (!node) return;
+
+	dialogProgress("Computing addresses", 0);
+	// the parent is derived once, the children only need public derivation
+	for (i = 0; i < msg->count; i += cnt) {
+		cnt = msg->count - i;
+		if (cnt > ADDRESS_BATCH) cnt = ADDRESS_BATCH;
+		for (k = 0; k < cnt; k++) {
+			memcpy(&nodes[k], node, sizeof(HDNode));
+			batch[k] = &nodes[k];
+			index[k] = start + i + k;
+		}
+		hdnode_public_ckd_batch(batch, index, cnt);
+		for (k = 0; k < cnt; k++) {
+			// a node that could not be derived keeps its depth
+			if (nodes[k].depth != node->depth + 1 ||
+			    !compute_address(coin, msg->script_type, &nodes[k], false, NULL, resp->address[i + k])) {
+				memset(nodes, 0, sizeof(nodes));
+				fsm_sendFailure(FailureType_Failure_ProcessError, "Failed to derive address");
+				dialogClear();
+				return;
+			}
+		}
+		dialogProgress("Computing addresses", (i + cnt) * 1000 / msg->count);
+	}
+	memset(nodes, 0, sizeof(nodes));
+	resp->address_count = msg->count;
+
+	msg_write(MessageType_MessageType_Addresses, resp);
+	dialogClear();
+}
+
 void fsm_msgEntropyAck(EntropyAck *msg)
 {
 	REQ(EntropyAck);
@@ -560,7 +620,7 @@ void fsm_msgSignMessage(SignMessage *msg)
 
 	const CoinType *coin = fsm_getCoin(msg->has_coin_name, msg->coin_name);
 	if (!coin) return;
-	HDNode *node = fsm_getDerivedNode(SECP256K1_NAME, msg->address_n, msg->address_n_count);
+	HDNode *node = fsm_getDerivedNode(SECP256K1_NAME, msg->address_n, msg->address_n_count, NULL);
 	if (!node) return;
 
 	dialogProgress("Signing", 0);
@@ -650,7 +710,7 @@ void fsm_msgSignIdentity(SignIdentity *msg)
 	if (msg->has_ecdsa_curve_name) {
 		curve = msg->ecdsa_curve_name;
 	}
-	HDNode *node = fsm_getDerivedNode(curve, address_n, 5);
+	HDNode *node = fsm_getDerivedNode(curve, address_n, 5, NULL);
 	if (!node) return;
 
 	bool sign_ssh = msg->identity.has_proto && (strcmp(msg->identity.proto, "ssh") == 0);
@@ -728,7 +788,7 @@ void fsm_msgGetECDHSessionKey(GetECDHSessionKey *msg)
 		curve = msg->ecdsa_curve_name;
 	}
 
-	const HDNode *node = fsm_getDerivedNode(curve, address_n, 5);
+	const HDNode *node = fsm_getDerivedNode(curve, address_n, 5, NULL);
 	if (!node) return;
 
 	int result_size = 0;
@@ -47,6 +47,7 @@ void fsm_msgApplySettings(ApplySettings *msg);
 void fsm_msgApplyFlags(ApplyFlags *msg);
 //void fsm_msgButtonAck(ButtonAck *msg);
 void fsm_msgGetAddress(GetAddress *msg);
+void fsm_msgGetAddresses(GetAddresses *msg);
 void fsm_msgEntropyAck(EntropyAck *msg);
 void fsm_msgSignMessage(SignMessage *msg);
 void fsm_msgVerifyMessage(VerifyMessage *msg);
@@ -33,11 +33,26 @@
 //#define MDBG2(s...) dprintf(s)
 #define MDBG2(s...)
 
-static uint8_t msg_outbuf[2+HID_BLOCK_SIZE];
+// HID reports carry a 2 byte header and are padded to HID_BLOCK_SIZE,
+// stream packets are raw protocol bytes of up to ATT MTU - 3
+#define MSG_TRANSPORT_HID    0
+#define MSG_TRANSPORT_STREAM 1
+
+#if BLE_STREAM_MAX_DATA_LEN > HID_BLOCK_SIZE
+#define MSG_BLOCK_SIZE BLE_STREAM_MAX_DATA_LEN
+#else
+#define MSG_BLOCK_SIZE HID_BLOCK_SIZE
+#endif
+
+static uint8_t msg_transport = MSG_TRANSPORT_HID;
+
+static uint8_t msg_outbuf[2+MSG_BLOCK_SIZE];
 static uint32_t msg_outlen = 0;
+static uint32_t msg_outblock = HID_BLOCK_SIZE;
 static uint32_t msg_outstatus;
 
-static uint8_t msg_inbuf[2+HID_BLOCK_SIZE];
+// payload of the last write event, decoded in place from gs_evt_buf
+static const uint8_t *msg_indata;
 static uint32_t msg_inpos = 0;
 static uint32_t msg_inlen = 0;
 static uint32_t msg_instatus;
@@ -48,68 +63,76 @@ struct MessagesMap_t
 {
 	char type;	// n = normal, d = debug
 	char dir; 	// i = in, o = out
-	uint16_t msg_id;
+	uint16_t size;	// sizeof the decoded struct
 	const pb_field_t *fields;
 	void (*process_func)(void *ptr);
 };
 
-static const struct MessagesMap_t inMessagesMap[] =
+#define MSG_IN(NAME)  [MessageType_MessageType_##NAME] = { 'n', 'i', sizeof(NAME), NAME##_fields, (mproc) fsm_msg##NAME }
+#define MSG_OUT(NAME) [MessageType_MessageType_##NAME] = { 'n', 'o', sizeof(NAME), NAME##_fields, 0 }
+
+// indexed by message id, unused ids are left zero
+static const struct MessagesMap_t messagesMap[] =
 {
-	// in messages
-
-	{ 'n', 'i', MessageType_MessageType_Initialize,        Initialize_fields,        (mproc) fsm_msgInitialize },
-	{ 'n', 'i', MessageType_MessageType_Ping,              Ping_fields,              (mproc) fsm_msgPing },
-	{ 'n', 'i', MessageType_MessageType_ChangePin,         ChangePin_fields,         (mproc) fsm_msgChangePin },
-	{ 'n', 'i', MessageType_MessageType_WipeDevice,        WipeDevice_fields,        (mproc) fsm_msgWipeDevice },
-	{ 'n', 'i', MessageType_MessageType_GetEntropy,        GetEntropy_fields,        (mproc) fsm_msgGetEntropy },
-	{ 'n', 'i', MessageType_MessageType_GetPublicKey,      GetPublicKey_fields,      (mproc) fsm_msgGetPublicKey },
-	{ 'n', 'i', MessageType_MessageType_ResetDevice,       ResetDevice_fields,       (mproc) fsm_msgResetDevice },
-	{ 'n', 'i', MessageType_MessageType_SignTx,            SignTx_fields,            (mproc) fsm_msgSignTx },
-	{ 'n', 'i', MessageType_MessageType_Cancel,            Cancel_fields,            (mproc) fsm_msgCancel },
-	{ 'n', 'i', MessageType_MessageType_TxAck,             TxAck_fields,             (mproc) fsm_msgTxAck },
-	{ 'n', 'i', MessageType_MessageType_ClearSession,      ClearSession_fields,      (mproc) fsm_msgClearSession },
-	{ 'n', 'i', MessageType_MessageType_ApplySettings,     ApplySettings_fields,     (mproc) fsm_msgApplySettings },
-	{ 'n', 'i', MessageType_MessageType_ApplyFlags,        ApplyFlags_fields,        (mproc) fsm_msgApplyFlags },
-	{ 'n', 'i', MessageType_MessageType_GetAddress,        GetAddress_fields,        (mproc) fsm_msgGetAddress },
-	{ 'n', 'i', MessageType_MessageType_BackupDevice,      BackupDevice_fields,      (mproc) fsm_msgBackupDevice },
-	{ 'n', 'i', MessageType_MessageType_EntropyAck,        EntropyAck_fields,        (mproc) fsm_msgEntropyAck },
-	{ 'n', 'i', MessageType_MessageType_SignMessage,       SignMessage_fields,       (mproc) fsm_msgSignMessage },
-	{ 'n', 'i', MessageType_MessageType_VerifyMessage,     VerifyMessage_fields,     (mproc) fsm_msgVerifyMessage },
-	{ 'n', 'i', MessageType_MessageType_SignIdentity,      SignIdentity_fields,      (mproc) fsm_msgSignIdentity },
-	{ 'n', 'i', MessageType_MessageType_GetFeatures,       GetFeatures_fields,       (mproc) fsm_msgGetFeatures },
-	{ 'n', 'i', MessageType_MessageType_GetECDHSessionKey, GetECDHSessionKey_fields, (mproc) fsm_msgGetECDHSessionKey },
-	{0, 0, 0, 0, 0}
+	MSG_IN(Initialize),
+	MSG_IN(Ping),
+	MSG_OUT(Success),
+	MSG_OUT(Failure),
+	MSG_IN(ChangePin),
+	MSG_IN(WipeDevice),
+	MSG_IN(GetEntropy),
+	MSG_OUT(Entropy),
+	MSG_IN(GetPublicKey),
+	MSG_OUT(PublicKey),
+	MSG_IN(ResetDevice),
+	MSG_IN(SignTx),
+	MSG_OUT(Features),
+	MSG_OUT(PinMatrixRequest),
+	MSG_IN(Cancel),
+	MSG_OUT(TxRequest),
+	MSG_IN(TxAck),
+	MSG_IN(ClearSession),
+	MSG_IN(ApplySettings),
+	MSG_OUT(ButtonRequest),
+	MSG_IN(ApplyFlags),
+	MSG_IN(GetAddress),
+	MSG_OUT(Address),
+	MSG_IN(BackupDevice),
+	MSG_OUT(EntropyRequest),
+	MSG_IN(EntropyAck),
+	MSG_IN(SignMessage),
+	MSG_IN(VerifyMessage),
+	MSG_OUT(MessageSignature),
+	MSG_OUT(PassphraseRequest),
+	MSG_IN(SignIdentity),
+	MSG_OUT(SignedIdentity),
+	MSG_IN(GetFeatures),
+	MSG_IN(GetECDHSessionKey),
+	MSG_OUT(ECDHSessionKey),
+	MSG_IN(GetAddresses),
+	MSG_OUT(Addresses),
 };
 
-static const struct MessagesMap_t outMessagesMap[] =
+#define MESSAGES_MAP_COUNT (sizeof(messagesMap) / sizeof(messagesMap[0]))
+
+static const struct MessagesMap_t *msg_lookup(char dir, uint16_t msg_id)
 {
-	// out messages
-
-	{ 'n', 'o', MessageType_MessageType_Success,           Success_fields,           0 },
-	{ 'n', 'o', MessageType_MessageType_Failure,           Failure_fields,           0 },
-	{ 'n', 'o', MessageType_MessageType_Entropy,           Entropy_fields,           0 },
-	{ 'n', 'o', MessageType_MessageType_PublicKey,         PublicKey_fields,         0 },
-	{ 'n', 'o', MessageType_MessageType_Features,          Features_fields,          0 },
-	{ 'n', 'o', MessageType_MessageType_PinMatrixRequest,  PinMatrixRequest_fields,  0 },
-	{ 'n', 'o', MessageType_MessageType_TxRequest,         TxRequest_fields,         0 },
-	{ 'n', 'o', MessageType_MessageType_ButtonRequest,     ButtonRequest_fields,     0 },
-	{ 'n', 'o', MessageType_MessageType_Address,           Address_fields,           0 },
-	{ 'n', 'o', MessageType_MessageType_EntropyRequest,    EntropyRequest_fields,    0 },
-	{ 'n', 'o', MessageType_MessageType_MessageSignature,  MessageSignature_fields,  0 },
-	{ 'n', 'o', MessageType_MessageType_PassphraseRequest, PassphraseRequest_fields, 0 },
-	{ 'n', 'o', MessageType_MessageType_SignedIdentity,    SignedIdentity_fields,    0 },
-	{ 'n', 'o', MessageType_MessageType_ECDHSessionKey,    ECDHSessionKey_fields,    0 },
-	{0, 0, 0, 0, 0}
-};
+	if (msg_id >= MESSAGES_MAP_COUNT) return NULL;
+	if (messagesMap[msg_id].dir != dir) return NULL;
+	return &messagesMap[msg_id];
+}
 
 void msg_process(void);
 
+static bool decoding = false;
+
 void hid_message_receive(uint8_t *data, int len)
 {
-	static bool decoding = false;;
-
-	// store hid message to buffer, handle later
+	// point at the report payload, handle later
 	MDBG2("R %d [%*b]\n", len, len, data);
+	// a message in progress is read from its own transport only,
+	// msg_in_wait() keeps waiting until that one delivers
+	if (decoding && msg_transport != MSG_TRANSPORT_HID) return;
 	if (data[0] == 0x00) {
 		// extra byte
 		data++;
@@ -117,12 +140,29 @@ void hid_message_receive(uint8_t *data, int len)
 	}
 	if (len < 1+HID_BLOCK_SIZE) return;
 	if (data[0] != HID_BLOCK_SIZE) return;
-	memcpy(msg_inbuf, data+1, HID_BLOCK_SIZE);
+	msg_indata = data+1;
 	msg_inpos = 0;
 	msg_inlen = HID_BLOCK_SIZE;
 	// call msg_process() for first message, otherwise we're called from pb_callback
 	if (! decoding) {
 		decoding = true;
+		msg_transport = MSG_TRANSPORT_HID;
+		msg_process();
+		decoding = false;
+	}
+}
+
+void stream_message_receive(uint8_t *data, int len)
+{
+	MDBG2("S %d [%*b]\n", len, len, data);
+	if (decoding && msg_transport != MSG_TRANSPORT_STREAM) return;
+	if (len < 1) return;
+	msg_indata = data;
+	msg_inpos = 0;
+	msg_inlen = len;
+	if (! decoding) {
+		decoding = true;
+		msg_transport = MSG_TRANSPORT_STREAM;
 		msg_process();
 		decoding = false;
 	}
@@ -130,69 +170,112 @@ void hid_message_receive(uint8_t *data, int len)
 
 uint32_t hid_message_send(uint8_t *data, u16 len)
 {
-	uint32_t ret;
-	uint32_t t = JIFFIES;
-	while (TIMEDIFF(JIFFIES, t) < HID_IO_TIMEOUT) {
-		ret = ble_notification(hid_rx_handles.value_handle, data, len);
-		if (ret == NRF_SUCCESS) {
-			MDBG2("W %d [%*b]\n", len, len, data);
-			return ret;
-		}
-		if (ret == NRF_ERROR_BUSY || ret == BLE_ERROR_NO_TX_BUFFERS) {
-			ble_check_event();
-			continue;
-		}
+	uint16_t handle = (msg_transport == MSG_TRANSPORT_STREAM) ? stream_rx_handles.value_handle : hid_rx_handles.value_handle;
+	uint32_t ret = ble_notification_queue(handle, data, len);
+	if (ret != NRF_SUCCESS) {
 		MDBG("message_send: %x\n", ret);
 		return ret;
 	}
-	MDBG("hid_message_send timeout\n");
-	return NRF_ERROR_TIMEOUT;
+	MDBG2("W %d [%*b]\n", len, len, data);
+	return ret;
 }
 
 
+static void msg_out_flush(void)
+{
+	if (msg_transport == MSG_TRANSPORT_STREAM) {
+		msg_outstatus = hid_message_send(msg_outbuf+2, msg_outlen);
+	} else {
+		msg_outstatus = hid_message_send(msg_outbuf, 2+HID_BLOCK_SIZE);
+	}
+	msg_outlen = 0;
+}
+
 static void msg_out_append(uint8_t c)
 {
 	msg_outbuf[2+msg_outlen] = c;
 	msg_outlen++;
-	if (msg_outlen == HID_BLOCK_SIZE) {
-		msg_outstatus = hid_message_send(msg_outbuf, 2+HID_BLOCK_SIZE);
-		msg_outlen = 0;
+	if (msg_outlen == msg_outblock) {
+		msg_out_flush();
 	}
 }
 
 static bool pb_callback_out(pb_ostream_t *stream, const uint8_t *buf, size_t count)
 {
 	(void)stream;
-	for (size_t i = 0; i < count; i++) {
-		if (msg_outstatus != NRF_SUCCESS) break;
-		msg_out_append(buf[i]);
+	while (count && msg_outstatus == NRF_SUCCESS) {
+		size_t n = msg_outblock - msg_outlen;
+		if (n > count) n = count;
+		memcpy(msg_outbuf + 2 + msg_outlen, buf, n);
+		msg_outlen += n;
+		buf += n;
+		count -= n;
+		if (msg_outlen == msg_outblock) {
+			msg_out_flush();
+		}
 	}
 	return (msg_outstatus == NRF_SUCCESS);
 }
 
-bool msg_write_common(char type, uint16_t msg_id, const void *msg_ptr)
+static const uint8_t *msg_scratch_end;
+
+// state is the write pointer, substreams for submessages share it
+static bool pb_callback_buf(pb_ostream_t *stream, const uint8_t *buf, size_t count)
 {
-	const pb_field_t *fields = NULL;
-	const struct MessagesMap_t *m = outMessagesMap;
-	while (m->type) {
-		if (m->msg_id == msg_id) {
-			fields = m->fields;
-		}
-		m++;
+	uint8_t *dest = (uint8_t *)stream->state;
+	if (dest + count > msg_scratch_end) return false;
+	memcpy(dest, buf, count);
+	stream->state = dest + count;
+	return true;
+}
+
+// Largest part of shared_buffer not covered by the outgoing struct. The
+// request decoded there is no longer needed once the reply is written.
+static uint8_t *msg_out_scratch(const void *msg_ptr, size_t msg_size, size_t *len)
+{
+	const uint8_t *p = (const uint8_t *)msg_ptr;
+	size_t before, after;
+
+	if (p < shared_buffer || p >= shared_buffer + SHARED_BUFFER_SIZE) {
+		*len = SHARED_BUFFER_SIZE;
+		return shared_buffer;
 	}
-	if (!fields) {
-		MDBG("msg_write_common: unknown message %d\n", msg_id);
-		return false;
+	before = p - shared_buffer;
+	after = (before + msg_size < SHARED_BUFFER_SIZE) ? SHARED_BUFFER_SIZE - before - msg_size : 0;
+	if (before >= after) {
+		*len = before;
+		return shared_buffer;
 	}
+	*len = after;
+	return shared_buffer + before + msg_size;
+}
 
-	pb_ostream_t sizestream = {0, 0, SIZE_MAX, 0, 0};
-	bool status = pb_encode(&sizestream, fields, msg_ptr);
-
-	if (!status) {
+bool msg_write_common(char type, uint16_t msg_id, const void *msg_ptr)
+{
+	const struct MessagesMap_t *m = msg_lookup('o', msg_id);
+	if (!m) {
+		MDBG("msg_write_common: unknown message %d\n", msg_id);
 		return false;
 	}
-
-	uint32_t len = sizestream.bytes_written;
+	const pb_field_t *fields = m->fields;
+	size_t msg_size = m->size;
+
+	// encode once into free shared_buffer space so the length is known up
+	// front; only messages that don't fit there are encoded twice
+	size_t scratch_len;
+	uint8_t *scratch = msg_out_scratch(msg_ptr, msg_size, &scratch_len);
+	msg_scratch_end = scratch + scratch_len;
+	pb_ostream_t bufstream = {pb_callback_buf, scratch, SIZE_MAX, 0, 0};
+	bool buffered = pb_encode(&bufstream, fields, msg_ptr);
+	uint32_t len = bufstream.bytes_written;
+
+	if (!buffered) {
+		pb_ostream_t sizestream = {0, 0, SIZE_MAX, 0, 0};
+		if (!pb_encode(&sizestream, fields, msg_ptr)) {
+			return false;
+		}
+		len = sizestream.bytes_written;
+	}
 
 	msg_outbuf[0] = 0;
 	msg_outbuf[1] = HID_BLOCK_SIZE; // first byte is for all messages
@@ -205,39 +288,61 @@ bool msg_write_common(char type, uint16_t msg_id, const void *msg_ptr)
 	msg_outbuf[8] = (len >> 8) & 0xFF;
 	msg_outbuf[9] = len & 0xFF;
 	msg_outlen = 8;
+	msg_outblock = (msg_transport == MSG_TRANSPORT_STREAM) ? ble_stream_data_len() : HID_BLOCK_SIZE;
 	msg_outstatus = NRF_SUCCESS;
+	ble_notification_begin();
 
-	pb_ostream_t stream = {pb_callback_out, 0, SIZE_MAX, 0, 0};
-	pb_encode(&stream, fields, msg_ptr);
+	if (buffered) {
+		pb_callback_out(NULL, scratch, len);
+	} else {
+		pb_ostream_t stream = {pb_callback_out, 0, SIZE_MAX, 0, 0};
+		pb_encode(&stream, fields, msg_ptr);
+	}
 
-	// pad last message
-	while (msg_outstatus == NRF_SUCCESS && msg_outlen != 0) {
-		msg_out_append(0);
+	if (msg_transport == MSG_TRANSPORT_STREAM) {
+		// stream packets are not padded
+		if (msg_outstatus == NRF_SUCCESS && msg_outlen != 0) msg_out_flush();
+	} else {
+		// pad last message
+		while (msg_outstatus == NRF_SUCCESS && msg_outlen != 0) {
+			msg_out_append(0);
+		}
+	}
+	// the last packets are still queued, wait for their result
+	if (msg_outstatus == NRF_SUCCESS) {
+		msg_outstatus = ble_notification_flush();
+		if (msg_outstatus != NRF_SUCCESS) MDBG("message_send: %x\n", msg_outstatus);
 	}
 	return (msg_outstatus == NRF_SUCCESS);
 }
 
-static inline uint8_t msg_in_read(void)
+// Waits for the next write event. Its payload stays valid in gs_evt_buf
+// until the following ble_check_event(), which is not called before the
+// chunk is used up.
+static bool msg_in_wait(void)
 {
-	if (msg_inpos < msg_inlen) return msg_inbuf[msg_inpos++];
-
 	msg_inpos = msg_inlen = 0;
 	uint32_t t = JIFFIES;
 	while (TIMEDIFF(JIFFIES, t) < HID_IO_TIMEOUT) {
 		ble_wait_event();
-		if (msg_inpos < msg_inlen) return msg_inbuf[msg_inpos++];
+		if (msg_inpos < msg_inlen) return true;
 	}
 	MDBG("msg_in_read timeout\n");
 	msg_instatus = NRF_ERROR_TIMEOUT;
-	return 0;
+	return false;
 }
 
 static bool pb_callback_in(pb_istream_t *stream, uint8_t *buf, size_t count)
 {
 	(void)stream;
-	for (size_t i = 0; i < count; i++) {
-		if (msg_instatus != NRF_SUCCESS) break;
-		buf[i] = msg_in_read();
+	while (count && msg_instatus == NRF_SUCCESS) {
+		if (msg_inpos == msg_inlen && !msg_in_wait()) break;
+		size_t n = msg_inlen - msg_inpos;
+		if (n > count) n = count;
+		memcpy(buf, msg_indata + msg_inpos, n);
+		msg_inpos += n;
+		buf += n;
+		count -= n;
 	}
 	return (msg_instatus == NRF_SUCCESS);
 }
@@ -245,31 +350,22 @@ static bool pb_callback_in(pb_istream_t *stream, uint8_t *buf, size_t count)
 void msg_process(void)
 {
 	const struct MessagesMap_t *m;
-	void (*func)(void *) = NULL;
-        const pb_field_t *fields = NULL;
 
-	if (msg_inlen < 8 || msg_inbuf[0] != '#' || msg_inbuf[1] != '#') return;
+	if (msg_inlen < 8 || msg_indata[0] != '#' || msg_indata[1] != '#') return;
 
-	uint16_t msg_id = (msg_inbuf[2] << 8) + msg_inbuf[3];
-	uint32_t msg_size = (msg_inbuf[4] << 24)+ (msg_inbuf[5] << 16) + (msg_inbuf[6] << 8) + msg_inbuf[7];
+	uint16_t msg_id = (msg_indata[2] << 8) + msg_indata[3];
+	uint32_t msg_size = (msg_indata[4] << 24)+ (msg_indata[5] << 16) + (msg_indata[6] << 8) + msg_indata[7];
 	//MDBG("MSG:%d (%d)\n", msg_id, msg_size);
-	//MDBG("[%*b]\n", (msg_size>24) ? 24 : msg_size, msg_inbuf+8);
+	//MDBG("[%*b]\n", (msg_size>24) ? 24 : msg_size, msg_indata+8);
 
 	msg_inpos = 8;
 	msg_instatus = NRF_SUCCESS;
 
 	// find message handler
 
-	m = inMessagesMap;
-	while (m->type) {
-		if (m->msg_id == msg_id) {
-			func = m->process_func;
-			fields = m->fields;
-		}
-		m++;
-	}
+	m = msg_lookup('i', msg_id);
 
-	if (!fields) { // unknown message
+	if (!m) { // unknown message
 		fsm_sendFailure(FailureType_Failure_UnexpectedMessage, "Unknown message");
 		return;
 	}
@@ -279,11 +375,12 @@ void msg_process(void)
 	}
 
 	pb_istream_t stream = {pb_callback_in, 0, msg_size, 0};
-	memset(shared_buffer, 0, SHARED_BUFFER_SIZE);
-	bool status = pb_decode(&stream, fields, shared_buffer);
+	// pb_decode sets every field; clearing the struct covers padding and unused array tails
+	memset(shared_buffer, 0, m->size);
+	bool status = pb_decode(&stream, m->fields, shared_buffer);
 	if (status) {
 		// process message
-		if (func) (func)(shared_buffer);
+		if (m->process_func) (m->process_func)(shared_buffer);
 	} else {
 		fsm_sendFailure(FailureType_Failure_DataError, stream.errmsg);
 	}
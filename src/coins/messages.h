@@ -24,6 +24,7 @@
 #include <stdbool.h>
 
 void hid_message_receive(uint8_t *data, int len);
+void stream_message_receive(uint8_t *data, int len);
 uint32_t hid_message_send(uint8_t *data, uint16_t len);
 
 #define msg_read(buf, len) msg_read_common('n', (buf), (len))
@@ -6,6 +6,8 @@
 const char GetPublicKey_coin_name_default[21] = "Bitcoin";
 const char GetAddress_coin_name_default[21] = "Bitcoin";
 const InputScriptType GetAddress_script_type_default = InputScriptType_SPENDADDRESS;
+const char GetAddresses_coin_name_default[21] = "Bitcoin";
+const InputScriptType GetAddresses_script_type_default = InputScriptType_SPENDADDRESS;
 const char LoadDevice_language_default[17] = "english";
 const uint32_t ResetDevice_strength_default = 256u;
 const char ResetDevice_language_default[17] = "english";
@@ -159,6 +161,20 @@ const pb_field_t Address_fields[2] = {
     PB_LAST_FIELD
 };
 
+const pb_field_t GetAddresses_fields[6] = {
+    PB_FIELD2(  1, UINT32  , REPEATED, STATIC  , FIRST, GetAddresses, address_n, address_n, 0),
+    PB_FIELD2(  2, STRING  , OPTIONAL, STATIC  , OTHER, GetAddresses, coin_name, address_n, &GetAddresses_coin_name_default),
+    PB_FIELD2(  3, UINT32  , OPTIONAL, STATIC  , OTHER, GetAddresses, start_index, coin_name, 0),
+    PB_FIELD2(  4, UINT32  , REQUIRED, STATIC  , OTHER, GetAddresses, count, start_index, 0),
+    PB_FIELD2(  5, ENUM    , OPTIONAL, STATIC  , OTHER, GetAddresses, script_type, count, &GetAddresses_script_type_default),
+    PB_LAST_FIELD
+};
+
+const pb_field_t Addresses_fields[2] = {
+    PB_FIELD2(  1, STRING  , REPEATED, STATIC  , FIRST, Addresses, address, address, 0),
+    PB_LAST_FIELD
+};
+
 const pb_field_t WipeDevice_fields[1] = {
     PB_LAST_FIELD
 };
@@ -76,6 +76,8 @@ typedef enum _MessageType {
     MessageType_MessageType_EthereumSignMessage = 64,
     MessageType_MessageType_EthereumVerifyMessage = 65,
     MessageType_MessageType_EthereumMessageSignature = 66,
+    MessageType_MessageType_GetAddresses = 67,
+    MessageType_MessageType_Addresses = 68,
     MessageType_MessageType_DebugLinkDecision = 100,
     MessageType_MessageType_DebugLinkGetState = 101,
     MessageType_MessageType_DebugLinkState = 102,
@@ -128,6 +130,11 @@ typedef struct _Address {
     char address[60];
 } Address;
 
+typedef struct _Addresses {
+    size_t address_count;
+    char address[20][60];
+} Addresses;
+
 typedef struct _ApplySettings {
     // not implemented
     uint8_t dummy_field;
@@ -252,6 +259,18 @@ typedef struct _GetAddress {
     InputScriptType script_type;
 } GetAddress;
 
+typedef struct _GetAddresses {
+    size_t address_n_count;
+    uint32_t address_n[8];
+    bool has_coin_name;
+    char coin_name[21];
+    bool has_start_index;
+    uint32_t start_index;
+    uint32_t count;
+    bool has_script_type;
+    InputScriptType script_type;
+} GetAddresses;
+
 typedef struct {
     size_t size;
     uint8_t bytes[65];
@@ -479,6 +498,8 @@ typedef struct _RecoveryDevice {
 extern const char GetPublicKey_coin_name_default[21];
 extern const char GetAddress_coin_name_default[21];
 extern const InputScriptType GetAddress_script_type_default;
+extern const char GetAddresses_coin_name_default[21];
+extern const InputScriptType GetAddresses_script_type_default;
 extern const char LoadDevice_language_default[17];
 extern const uint32_t ResetDevice_strength_default;
 extern const char ResetDevice_language_default[17];
@@ -516,6 +537,8 @@ extern const uint32_t SignTx_lock_time_default;
 #define EthereumGetAddress_init_default          {0, {0, 0, 0, 0, 0, 0, 0, 0}, false, 0}
 #define Address_init_default                     {""}
 #define EthereumAddress_init_default             {{0, {0}}}
+#define GetAddresses_init_default                {0, {0, 0, 0, 0, 0, 0, 0, 0}, false, "Bitcoin", false, 0, 0, false, InputScriptType_SPENDADDRESS}
+#define Addresses_init_default                   {0, {"", "", "", "", "", "", "", "", "", "", "", "", "", "", "", "", "", "", "", ""}}
 #define WipeDevice_init_default                  {0}
 #define LoadDevice_init_default                  {false, "", false, HDNodeType_init_default, false, "", false, 0, false, "english", false, "", false, 0, false, 0}
 #define ResetDevice_init_default                 {false, 0, false, 256u, false, 0, false, 0, false, "english", false, "", false, 0, false, 0}
@@ -578,6 +601,8 @@ extern const uint32_t SignTx_lock_time_default;
 #define EthereumGetAddress_init_zero             {0, {0, 0, 0, 0, 0, 0, 0, 0}, false, 0}
 #define Address_init_zero                        {""}
 #define EthereumAddress_init_zero                {{0, {0}}}
+#define GetAddresses_init_zero                   {0, {0, 0, 0, 0, 0, 0, 0, 0}, false, "", false, 0, 0, false, (InputScriptType)0}
+#define Addresses_init_zero                      {0, {"", "", "", "", "", "", "", "", "", "", "", "", "", "", "", "", "", "", "", ""}}
 #define WipeDevice_init_zero                     {0}
 #define LoadDevice_init_zero                     {false, "", false, HDNodeType_init_zero, false, "", false, 0, false, "", false, "", false, 0, false, 0}
 #define ResetDevice_init_zero                    {false, 0, false, 0, false, 0, false, 0, false, "", false, "", false, 0, false, 0}
@@ -618,6 +643,7 @@ extern const uint32_t SignTx_lock_time_default;
 
 /* Field tags (for use in manual encoding/decoding) */
 #define Address_address_tag                      1
+#define Addresses_address_tag                    1
 #define ApplyFlags_flags_tag                     1
 #define ApplySettings_language_tag               1
 #define ApplySettings_label_tag                  2
@@ -709,6 +735,11 @@ extern const uint32_t SignTx_lock_time_default;
 #define GetAddress_show_display_tag              3
 #define GetAddress_multisig_tag                  4
 #define GetAddress_script_type_tag               5
+#define GetAddresses_address_n_tag               1
+#define GetAddresses_coin_name_tag               2
+#define GetAddresses_start_index_tag             3
+#define GetAddresses_count_tag                   4
+#define GetAddresses_script_type_tag             5
 #define GetECDHSessionKey_identity_tag           1
 #define GetECDHSessionKey_peer_public_key_tag    2
 #define GetECDHSessionKey_ecdsa_curve_name_tag   3
@@ -808,6 +839,8 @@ extern const pb_field_t GetAddress_fields[6];
 extern const pb_field_t EthereumGetAddress_fields[3];
 extern const pb_field_t Address_fields[2];
 extern const pb_field_t EthereumAddress_fields[2];
+extern const pb_field_t GetAddresses_fields[6];
+extern const pb_field_t Addresses_fields[2];
 extern const pb_field_t WipeDevice_fields[1];
 extern const pb_field_t LoadDevice_fields[9];
 extern const pb_field_t ResetDevice_fields[9];
@@ -872,6 +905,8 @@ extern const pb_field_t DebugLinkFlashErase_fields[2];
 #define EthereumGetAddress_size                  50
 #define Address_size                             62
 #define EthereumAddress_size                     22
+#define GetAddresses_size                        93
+#define Addresses_size                           1240
 #define WipeDevice_size                          0
 #define LoadDevice_size                          (326 + HDNodeType_size)
 #define ResetDevice_size                         74
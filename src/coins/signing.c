@@ -416,7 +416,6 @@ bool compile_input_script_sig(TxInputType *tinput)
 		// Failed to derive private key
 		return false;
 	}
-	hdnode_fill_public_key(&node);
 	if (tinput->has_multisig) {
 		tinput->script_sig.size = compile_script_multisig(&(tinput->multisig), tinput->script_sig.bytes);
 	} else { // SPENDADDRESS
@@ -39,6 +39,26 @@ static uint8_t sessionSeed[64];
 
 static bool sessionPinCached;
 
+// master nodes derived from sessionSeed, one slot per curve known
+// to get_curve_by_name
+#define SESSION_ROOT_CACHE_SIZE 1
+
+static struct {
+	const curve_info *curve;
+	HDNode node;
+} sessionRootCache[SESSION_ROOT_CACHE_SIZE];
+
+static int sessionRootCacheIndex;
+
+// account nodes derived in the background once the PIN is cached,
+// one per main loop iteration
+static const uint32_t prewarmPaths[][3] = {
+	{ 0x80000000 | 44, 0x80000000 | 0, 0x80000000 | 0 }, // m/44'/0'/0'
+	{ 0x80000000 | 49, 0x80000000 | 0, 0x80000000 | 0 }, // m/49'/0'/0'
+};
+
+static int sessionPrewarmStep;
+
 static void seed_from_entropy(uint8_t *seed, const uint8_t *entropy)
 {
 	hmac_sha512((const uint8_t *)"entropy", 7, entropy, 32, seed);
@@ -49,6 +69,12 @@ void session_clear(bool clear_pin)
 {
 	sessionSeedCached = false;
 	memset(&sessionSeed, 0, sizeof(sessionSeed));
+	memset(&sessionRootCache, 0, sizeof(sessionRootCache));
+	sessionRootCacheIndex = 0;
+	sessionPrewarmStep = 0;
+#if USE_BIP32_CACHE
+	bip32_cache_clear();
+#endif
 	if (clear_pin) {
 		sessionPinCached = false;
 	}
@@ -80,9 +106,51 @@ const uint8_t *storage_getSeed(void)
 
 bool storage_getRootNode(HDNode *node, const char *curve)
 {
+	const curve_info *info = get_curve_by_name(curve);
+	int i;
+
+	if (! info) return false;
+	for (i = 0; i < SESSION_ROOT_CACHE_SIZE; i++) {
+		if (sessionRootCache[i].curve == info) {
+			memcpy(node, &sessionRootCache[i].node, sizeof(HDNode));
+			return true;
+		}
+	}
+
 	const uint8_t *seed = storage_getSeed();
 	if (! seed) return false;
-	return hdnode_from_seed(seed, 64, curve, node);
+	if (! hdnode_from_seed(seed, 64, curve, node)) return false;
+
+	i = sessionRootCacheIndex;
+	sessionRootCache[i].curve = info;
+	memcpy(&sessionRootCache[i].node, node, sizeof(HDNode));
+	sessionRootCacheIndex = (i + 1) % SESSION_ROOT_CACHE_SIZE;
+	return true;
+}
+
+/* Derive the next account node into the BIP32 cache, the same way
+ * GetPublicKey does, so that the first request after unlock finds
+ * the hardened part of its path and the public keys already cached.
+ * Returns false when there is nothing (left) to do.
+ */
+bool session_prewarm(void)
+{
+#if USE_BIP32_CACHE
+	HDNode node;
+	uint32_t fingerprint;
+
+	if (sessionPrewarmStep >= sizeof(prewarmPaths) / sizeof(prewarmPaths[0])) return false;
+	if (! sessionPinCached || ! storage_isInitialized()) return false;
+	if (! storage_getRootNode(&node, SECP256K1_NAME)) return false;
+
+	// caches the nodes on the path and the account public key
+	hdnode_private_ckd_cached(&node, prewarmPaths[sessionPrewarmStep], 3, &fingerprint);
+	memset(&node, 0, sizeof(node));
+	sessionPrewarmStep++;
+	return true;
+#else
+	return false;
+#endif
 }
 
 /* Check whether pin matches storage.  The pin must be
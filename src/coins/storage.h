@@ -28,6 +28,7 @@
 void session_clear(bool clear_pin);
 void session_cachePin(void);
 bool session_isPinCached(void);
+bool session_prewarm(void);
 
 bool storage_isInitialized(void);
 bool storage_needsBackup(void);
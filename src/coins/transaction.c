@@ -175,10 +175,10 @@ int compile_output(const CoinType *coin, const HDNode *root, TxOutputType *in, T
 				return 0; // failed to compile output
 		}
 		memcpy(&node, root, sizeof(HDNode));
-		if (hdnode_private_ckd_cached(&node, in->address_n, in->address_n_count, NULL) == 0) {
+		// only the public key of the change address is needed
+		if (hdnode_public_ckd_cached(&node, in->address_n, in->address_n_count) == 0) {
 			return 0; // failed to compile output
 		}
-		hdnode_fill_public_key(&node);
 		if (!compute_address(coin, input_script_type, &node,
 							 in->has_multisig, &in->multisig,
 							 in->address)) {
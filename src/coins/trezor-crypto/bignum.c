@@ -393,11 +393,21 @@ void bn_mod(bignum256 *x, const bignum256 *prime)
 	bn_cmov(x, flag, x, &temp);
 }
 
+#if USE_BN_ASM
+// Cortex-M0 implementations, see bignum_m0.s
+void bn_multiply_long_m0(const bignum256 *k, const bignum256 *x, uint32_t res[18]);
+void bn_square_long_m0(const bignum256 *x, uint32_t res[18]);
+void bn_multiply_reduce_step_m0(uint32_t res[18], const bignum256 *prime, uint32_t i);
+#endif
+
 // auxiliary function for multiplication.
 // compute k * x as a 540 bit number in base 2^30 (normalized).
 // assumes that k and x are normalized.
 void bn_multiply_long(const bignum256 *k, const bignum256 *x, uint32_t res[18])
 {
+#if USE_BN_ASM
+	bn_multiply_long_m0(k, x, res);
+#else
 	int i, j;
 	uint64_t temp = 0;
 
@@ -422,6 +432,7 @@ void bn_multiply_long(const bignum256 *k, const bignum256 *x, uint32_t res[18])
 		temp >>= 30;
 	}
 	res[17] = temp;
+#endif
 }
 
 // auxiliary function for multiplication.
@@ -429,6 +440,9 @@ void bn_multiply_long(const bignum256 *k, const bignum256 *x, uint32_t res[18])
 // assumes    res normalized, res < 2^(30(i-7)) * 2 * prime
 // guarantees res normalized, res < 2^(30(i-8)) * 2 * prime
 void bn_multiply_reduce_step(uint32_t res[18], const bignum256 *prime, uint32_t i) {
+#if USE_BN_ASM
+	bn_multiply_reduce_step_m0(res, prime, i);
+#else
 	// let k = i-8.
 	// on entry:
 	//   0 <= res < 2^(30k + 31) * prime
@@ -460,6 +474,7 @@ void bn_multiply_reduce_step(uint32_t res[18], const bignum256 *prime, uint32_t
 	// Hence, 0 <= res < 2^30k (2^256 + coef * (2^256 - prime))
 	//                 < 2^30k (2^256 + 2^31 * 2^224)
 	//                 < 2^30k (2 * prime)
+#endif
 }
 
 
@@ -494,6 +509,111 @@ void bn_multiply(const bignum256 *k, bignum256 *x, const bignum256 *prime)
 	MEMSET_BZERO(res, sizeof(res));
 }
 
+#if USE_SECP256K1_REDUCTION
+
+// Compute res = x * x  (the same as bn_multiply_long(x, x, res))
+// every cross product is computed only once and doubled.
+void bn_square_long(const bignum256 *x, uint32_t res[18])
+{
+#if USE_BN_ASM
+	bn_square_long_m0(x, res);
+#else
+	int i, j;
+	uint64_t temp = 0, cross;
+
+	for (i = 0; i < 17; i++)
+	{
+		cross = 0;
+		for (j = (i < 9) ? 0 : i - 8; j < i - j; j++) {
+			// at most 4 cross products, 2 * 4 * 2^60 + 2^60 < 2^64
+			cross += x->val[j] * (uint64_t)x->val[i - j];
+		}
+		temp += cross << 1;
+		if ((i & 1) == 0) {
+			temp += x->val[i >> 1] * (uint64_t)x->val[i >> 1];
+		}
+		res[i] = temp & 0x3FFFFFFFu;
+		temp >>= 30;
+	}
+	res[17] = temp;
+#endif
+}
+
+// auxiliary function for multiplication modulo the secp256k1 prime
+// p = 2^256 - 2^32 - 977.
+// Since 2^256 = 2^32 + 977 (mod p), the part of res above bit 256 is
+// folded back by a multiplication with the 33 bit constant 2^32 + 977
+// = 4 * 2^30 + 977, which is done twice.
+// assumes    res normalized, res < 2^540
+// guarantees x partly reduced, i.e., x < 2 * prime
+static void bn_multiply_reduce_secp256k1(bignum256 *x, uint32_t res[18])
+{
+	int i;
+	uint32_t h[10];
+	uint64_t temp;
+
+	// res = lo + h * 2^256, with h < 2^284
+	for (i = 0; i < 9; i++) {
+		h[i] = ((res[i + 8] >> 16) | (res[i + 9] << 14)) & 0x3FFFFFFF;
+	}
+	h[9] = res[17] >> 16;
+	res[8] &= 0xFFFF;
+
+	// res = lo + h * (4 * 2^30 + 977) < 2^318
+	temp = res[0] + h[0] * (uint64_t)977;
+	res[0] = temp & 0x3FFFFFFF;
+	for (i = 1; i < 10; i++) {
+		temp >>= 30;
+		temp += (i < 9 ? res[i] : 0) + h[i] * (uint64_t)977 + (h[i - 1] << 2);
+		res[i] = temp & 0x3FFFFFFF;
+	}
+	temp >>= 30;
+	res[10] = temp + (h[9] << 2);
+
+	// once more with h < 2^62
+	h[0] = ((res[8] >> 16) | (res[9] << 14)) & 0x3FFFFFFF;
+	h[1] = ((res[9] >> 16) | (res[10] << 14)) & 0x3FFFFFFF;
+	h[2] = res[10] >> 16;
+	res[8] &= 0xFFFF;
+
+	// x = lo + h * (4 * 2^30 + 977) < 2^256 + 2^96 < 2 * prime
+	temp = res[0] + h[0] * (uint64_t)977;
+	x->val[0] = temp & 0x3FFFFFFF;
+	for (i = 1; i < 9; i++) {
+		temp >>= 30;
+		temp += res[i];
+		if (i < 3) {
+			temp += h[i] * (uint64_t)977;
+		}
+		if (i < 4) {
+			temp += h[i - 1] << 2;
+		}
+		x->val[i] = temp & 0x3FFFFFFF;
+	}
+	MEMSET_BZERO(h, sizeof(h));
+}
+
+// Compute x := k * x  (mod secp256k1 prime)
+// same contract as bn_multiply, but both inputs only need to be normalized.
+void bn_multiply_secp256k1(const bignum256 *k, bignum256 *x)
+{
+	uint32_t res[18];
+	bn_multiply_long(k, x, res);
+	bn_multiply_reduce_secp256k1(x, res);
+	MEMSET_BZERO(res, sizeof(res));
+}
+
+// Compute x := x * x  (mod secp256k1 prime)
+void bn_square_secp256k1(bignum256 *x)
+{
+	uint32_t res[18];
+	bn_square_long(x, res);
+	bn_multiply_reduce_secp256k1(x, res);
+	MEMSET_BZERO(res, sizeof(res));
+}
+
+#endif
+
 // partly reduce x modulo prime
 // input x does not have to be normalized.
 // x can be any number that fits.
@@ -557,7 +677,209 @@ void bn_sqrt(bignum256 *x, const bignum256 *prime)
 	MEMSET_BZERO(&p, sizeof(p));
 }
 
-#if ! USE_INVERSE_FAST
+#if USE_INVERSE_SAFEGCD
+
+// The constant time inverse below is the "safegcd" algorithm of Bernstein
+// and Yang, "Fast constant-time gcd computation and modular inversion",
+// in the formulation used by libsecp256k1.  Numbers are kept in signed
+// base 2^30 form, i.e. the bignum256 limb layout with int32_t limbs, so
+// that intermediate values may be negative.
+
+typedef struct {
+	int32_t val[9];
+} bn_signed30;
+
+// 2x2 transition matrix of 30 divsteps, scaled by 2^30
+typedef struct {
+	int32_t u, v, q, r;
+} bn_trans2x2;
+
+// perform 30 divsteps on the low limbs f0 (odd) and g0 of f and g,
+// starting from zeta = -(delta + 1/2).  The matrix t is computed such that
+// t * [f, g] = 2^30 * [f', g'] for the new values f', g'.
+// returns the new zeta.
+static int32_t bn_divsteps_30(int32_t zeta, uint32_t f0, uint32_t g0, bn_trans2x2 *t)
+{
+	// u,v,q,r are signed values in [-2^30, 2^30], kept unsigned here to
+	// allow left shifts of negative numbers
+	uint32_t u = 1, v = 0, q = 0, r = 1;
+	uint32_t c1, c2, x, y, z, f = f0, g = g0;
+	int i;
+
+	for (i = 0; i < 30; i++) {
+		// c1 = all ones if zeta < 0, c2 = all ones if g is odd
+		c1 = (uint32_t)(zeta >> 31);
+		c2 = -(g & 1);
+		// conditionally negated f, u, v
+		x = (f ^ c1) - c1;
+		y = (u ^ c1) - c1;
+		z = (v ^ c1) - c1;
+		// g odd: g += +-f
+		g += x & c2;
+		q += y & c2;
+		r += z & c2;
+		// zeta < 0 and g odd: swap (f = old g), zeta = -zeta - 2
+		c1 &= c2;
+		zeta = (zeta ^ (int32_t)c1) - 1;
+		f += g & c1;
+		u += q & c1;
+		v += r & c1;
+		g >>= 1;
+		u <<= 1;
+		v <<= 1;
+	}
+	t->u = (int32_t)u;
+	t->v = (int32_t)v;
+	t->q = (int32_t)q;
+	t->r = (int32_t)r;
+	return zeta;
+}
+
+// compute [d, e] = t * [d, e] / 2^30 modulo prime.  A multiple of prime is
+// added to make the division exact; d and e stay in (-2*prime, prime).
+// inv30 = prime^-1 mod 2^30
+static void bn_update_de_30(bn_signed30 *d, bn_signed30 *e, const bn_trans2x2 *t, const bignum256 *prime, uint32_t inv30)
+{
+	const int32_t u = t->u, v = t->v, q = t->q, r = t->r;
+	int32_t di, ei, md, me, sd, se;
+	int64_t cd, ce;
+	int i;
+
+	// start with the multiples of prime needed to keep d and e above
+	// -2*prime: [u, q] if d is negative plus [v, r] if e is negative
+	sd = d->val[8] >> 31;
+	se = e->val[8] >> 31;
+	md = (u & sd) + (v & se);
+	me = (q & sd) + (r & se);
+	di = d->val[0];
+	ei = e->val[0];
+	cd = (int64_t)u * di + (int64_t)v * ei;
+	ce = (int64_t)q * di + (int64_t)r * ei;
+	// correct md, me so that the lowest 30 bits of the sum vanish
+	md -= (inv30 * (uint32_t)cd + md) & 0x3FFFFFFF;
+	me -= (inv30 * (uint32_t)ce + me) & 0x3FFFFFFF;
+	cd += (int64_t)prime->val[0] * md;
+	ce += (int64_t)prime->val[0] * me;
+	cd >>= 30;
+	ce >>= 30;
+	for (i = 1; i < 9; i++) {
+		di = d->val[i];
+		ei = e->val[i];
+		cd += (int64_t)u * di + (int64_t)v * ei + (int64_t)prime->val[i] * md;
+		ce += (int64_t)q * di + (int64_t)r * ei + (int64_t)prime->val[i] * me;
+		d->val[i - 1] = (int32_t)cd & 0x3FFFFFFF;
+		e->val[i - 1] = (int32_t)ce & 0x3FFFFFFF;
+		cd >>= 30;
+		ce >>= 30;
+	}
+	d->val[8] = (int32_t)cd;
+	e->val[8] = (int32_t)ce;
+}
+
+// compute [f, g] = t * [f, g] / 2^30, the division is exact
+static void bn_update_fg_30(bn_signed30 *f, bn_signed30 *g, const bn_trans2x2 *t)
+{
+	const int32_t u = t->u, v = t->v, q = t->q, r = t->r;
+	int32_t fi, gi;
+	int64_t cf, cg;
+	int i;
+
+	fi = f->val[0];
+	gi = g->val[0];
+	cf = ((int64_t)u * fi + (int64_t)v * gi) >> 30;
+	cg = ((int64_t)q * fi + (int64_t)r * gi) >> 30;
+	for (i = 1; i < 9; i++) {
+		fi = f->val[i];
+		gi = g->val[i];
+		cf += (int64_t)u * fi + (int64_t)v * gi;
+		cg += (int64_t)q * fi + (int64_t)r * gi;
+		f->val[i - 1] = (int32_t)cf & 0x3FFFFFFF;
+		g->val[i - 1] = (int32_t)cg & 0x3FFFFFFF;
+		cf >>= 30;
+		cg >>= 30;
+	}
+	f->val[8] = (int32_t)cf;
+	g->val[8] = (int32_t)cg;
+}
+
+// compute d = d + prime if d < 0, with limbs normalized to 30 bits
+static void bn_signed30_add_if_negative(bn_signed30 *d, const bignum256 *prime)
+{
+	const int32_t mask = d->val[8] >> 31;
+	int i;
+
+	for (i = 0; i < 9; i++) {
+		d->val[i] += (int32_t)prime->val[i] & mask;
+	}
+	for (i = 0; i < 8; i++) {
+		d->val[i + 1] += d->val[i] >> 30;
+		d->val[i] &= 0x3FFFFFFF;
+	}
+}
+
+// in field G_prime, constant time and fast
+// the input must not be 0 mod prime.
+// the result is smaller than prime
+void bn_inverse(bignum256 *x, const bignum256 *prime)
+{
+	bn_signed30 d, e, f, g;
+	bn_trans2x2 t;
+	int32_t zeta = -1, neg;
+	uint32_t inv30;
+	int i;
+
+	// reduce x modulo prime, g must be smaller than f = prime
+	bn_fast_mod(x, prime);
+	bn_mod(x, prime);
+
+	// inv30 = prime^-1 mod 2^30, each Newton step doubles the correct bits
+	inv30 = prime->val[0];
+	for (i = 0; i < 4; i++) {
+		inv30 *= 2 - prime->val[0] * inv30;
+	}
+
+	// start with d = 0, e = 1, f = prime, g = x and delta = 1/2.  The
+	// invariants d * x = f and e * x = g (mod prime) are kept throughout.
+	memset(&d, 0, sizeof(d));
+	memset(&e, 0, sizeof(e));
+	e.val[0] = 1;
+	for (i = 0; i < 9; i++) {
+		f.val[i] = (int32_t)prime->val[i];
+		g.val[i] = (int32_t)x->val[i];
+	}
+
+	// 590 divsteps are enough to bring g to 0 for any 256 bit input,
+	// then f = +-1 and d = +-x^-1
+	for (i = 0; i < 20; i++) {
+		zeta = bn_divsteps_30(zeta, (uint32_t)f.val[0], (uint32_t)g.val[0], &t);
+		bn_update_de_30(&d, &e, &t, prime, inv30);
+		bn_update_fg_30(&f, &g, &t);
+	}
+
+	// d is in (-2*prime, prime), bring it to (-prime, prime), negate it
+	// if f = -1 and bring the result to [0, prime)
+	bn_signed30_add_if_negative(&d, prime);
+	neg = f.val[8] >> 31;
+	for (i = 0; i < 9; i++) {
+		d.val[i] = (d.val[i] ^ neg) - neg;
+	}
+	for (i = 0; i < 8; i++) {
+		d.val[i + 1] += d.val[i] >> 30;
+		d.val[i] &= 0x3FFFFFFF;
+	}
+	bn_signed30_add_if_negative(&d, prime);
+
+	for (i = 0; i < 9; i++) {
+		x->val[i] = (uint32_t)d.val[i];
+	}
+	MEMSET_BZERO(&d, sizeof(d));
+	MEMSET_BZERO(&e, sizeof(e));
+	MEMSET_BZERO(&f, sizeof(f));
+	MEMSET_BZERO(&g, sizeof(g));
+	MEMSET_BZERO(&t, sizeof(t));
+}
+
+#elif ! USE_INVERSE_FAST
 
 // in field G_prime, small but slow
 void bn_inverse(bignum256 *x, const bignum256 *prime)
@@ -868,6 +1190,43 @@ void bn_inverse(bignum256 *x, const bignum256 *prime)
 }
 #endif
 
+// compute x[i] := x[i]^-1 (mod prime) for all 0 <= i < n with a single
+// bn_inverse and 3(n-1) multiplications (Montgomery's trick).
+// tmp is scratch space for n numbers.
+// assumes    x[i] normalized and not 0 mod prime
+// guarantees x[i] reduced
+void bn_inverse_batch(bignum256 *x, bignum256 *tmp, int n, const bignum256 *prime)
+{
+	int i;
+	bignum256 inv, t;
+
+	if (n <= 0) {
+		return;
+	}
+	// tmp[i] = x[0] * ... * x[i]
+	tmp[0] = x[0];
+	for (i = 1; i < n; i++) {
+		tmp[i] = tmp[i - 1];
+		bn_multiply(&x[i], &tmp[i], prime);
+	}
+	inv = tmp[n - 1];
+	bn_inverse(&inv, prime);
+	for (i = n - 1; i > 0; i--) {
+		// inv = (x[0] * ... * x[i])^-1
+		t = tmp[i - 1];
+		bn_multiply(&inv, &t, prime);
+		bn_multiply(&x[i], &inv, prime);
+		x[i] = t;
+		bn_mod(&x[i], prime);
+	}
+	bn_mod(&inv, prime);
+	x[0] = inv;
+
+	MEMSET_BZERO(&inv, sizeof(inv));
+	MEMSET_BZERO(&t, sizeof(t));
+	MEMSET_BZERO(tmp, n * sizeof(bignum256));
+}
+
 void bn_normalize(bignum256 *a) {
 	bn_addi(a, 0);
 }
@@ -123,14 +123,26 @@ void bn_mult_k(bignum256 *x, uint8_t k, const bignum256 *prime);
 
 void bn_mod(bignum256 *x, const bignum256 *prime);
 
+void bn_multiply_long(const bignum256 *k, const bignum256 *x, uint32_t res[18]);
+
 void bn_multiply(const bignum256 *k, bignum256 *x, const bignum256 *prime);
 
+#if USE_SECP256K1_REDUCTION
+void bn_square_long(const bignum256 *x, uint32_t res[18]);
+
+void bn_multiply_secp256k1(const bignum256 *k, bignum256 *x);
+
+void bn_square_secp256k1(bignum256 *x);
+#endif
+
 void bn_fast_mod(bignum256 *x, const bignum256 *prime);
 
 void bn_sqrt(bignum256 *x, const bignum256 *prime);
 
 void bn_inverse(bignum256 *x, const bignum256 *prime);
 
+void bn_inverse_batch(bignum256 *x, bignum256 *tmp, int n, const bignum256 *prime);
+
 void bn_normalize(bignum256 *a);
 
 void bn_add(bignum256 *a, const bignum256 *b);
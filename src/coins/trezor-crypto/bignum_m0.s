@@ -0,0 +1,302 @@
+; Cortex-M0 (ARMv6-M, Thumb-1) implementation of the bignum multiplication
+; core, see bn_multiply_long, bn_square_long and bn_multiply_reduce_step in
+; bignum.c for the portable C versions and the exact contracts.
+;
+; ARMv6-M only has a 32x32->32 bit multiply, so every 30x30 bit limb product
+; is built from four 16x16 bit partial products:
+;
+;   a * b = (ah * bh) << 32 + (ah * bl + al * bh) << 16 + al * bl
+;
+; and accumulated into a 64 bit column sum held in r3:r2.  The limb loops
+; keep their pointers in high registers, all of r0-r7 are needed for the
+; partial products.
+
+                PRESERVE8
+                THUMB
+
+                AREA    |.text|, CODE, READONLY
+
+; void bn_multiply_long_m0(const bignum256 *k, const bignum256 *x, uint32_t res[18])
+;
+; r9  = &k[jlo]        first k limb of the column
+; r10 = &x[i - jhi]    last x limb of the column
+; r12 = &x[i - jlo]    first x limb of the column
+; r11 = &res[i]
+; [sp] = &x[8]
+
+bn_multiply_long_m0 PROC
+                EXPORT  bn_multiply_long_m0
+
+                push    {r4-r7, lr}
+                mov     r4, r8
+                mov     r5, r9
+                mov     r6, r10
+                mov     r7, r11
+                push    {r4-r7}
+                movs    r4, r1
+                adds    r4, #32
+                push    {r4}
+                mov     r9, r0
+                mov     r10, r1
+                mov     r12, r1
+                mov     r11, r2
+                movs    r2, #0
+                movs    r3, #0
+
+mul_column      mov     r8, r9
+                mov     r1, r12
+
+mul_inner       mov     r0, r8
+                ldm     r0!, {r4}               ; a = k[j]
+                mov     r8, r0
+                ldr     r5, [r1]                ; b = x[i - j]
+                subs    r1, #4
+                uxth    r6, r4                  ; al
+                lsrs    r4, r4, #16             ; ah
+                uxth    r7, r5                  ; bl
+                lsrs    r5, r5, #16             ; bh
+                movs    r0, r6
+                muls    r0, r7, r0              ; al * bl
+                muls    r7, r4, r7              ; ah * bl
+                muls    r4, r5, r4              ; ah * bh
+                muls    r5, r6, r5              ; al * bh
+                adds    r7, r7, r5              ; mid < 2^31
+                adds    r2, r2, r0
+                adcs    r3, r3, r4
+                lsls    r0, r7, #16
+                lsrs    r7, r7, #16
+                adds    r2, r2, r0
+                adcs    r3, r3, r7
+                cmp     r1, r10
+                bhs     mul_inner
+
+                ; res[i] = sum & 0x3FFFFFFF, sum >>= 30
+                lsls    r4, r2, #2
+                lsrs    r4, r4, #2
+                mov     r0, r11
+                stm     r0!, {r4}
+                mov     r11, r0
+                lsrs    r2, r2, #30
+                lsls    r4, r3, #2
+                orrs    r2, r2, r4
+                lsrs    r3, r3, #30
+
+                ; lower half (i < 8): only i - jlo grows
+                ldr     r4, [sp]
+                mov     r0, r12
+                cmp     r0, r4
+                bhs     mul_upper
+                adds    r0, #4
+                mov     r12, r0
+                b       mul_column
+
+                ; upper half: jlo and i - jhi grow, i - jlo stays 8
+mul_upper       mov     r0, r9
+                adds    r0, #4
+                mov     r9, r0
+                mov     r0, r10
+                adds    r0, #4
+                mov     r10, r0
+                cmp     r0, r4
+                bls     mul_column
+
+                mov     r0, r11
+                str     r2, [r0]                ; res[17]
+                add     sp, sp, #4
+                pop     {r4-r7}
+                mov     r8, r4
+                mov     r9, r5
+                mov     r10, r6
+                mov     r11, r7
+                pop     {r4-r7, pc}
+
+                ENDP
+
+; void bn_square_long_m0(const bignum256 *x, uint32_t res[18])
+;
+; Same column walk as bn_multiply_long_m0 with k = x, but every cross
+; product x[j] * x[i - j], j < i - j, is computed once as x[j] * 2x[i - j]
+; and the square x[i/2]^2 is added for even columns.
+;
+; r9  = &x[jlo]
+; r12 = &x[i - jlo]
+; r11 = &res[i]
+; [sp] = &x[8]
+
+bn_square_long_m0 PROC
+                EXPORT  bn_square_long_m0
+
+                push    {r4-r7, lr}
+                mov     r4, r8
+                mov     r5, r9
+                mov     r6, r10
+                mov     r7, r11
+                push    {r4-r7}
+                movs    r4, r0
+                adds    r4, #32
+                push    {r4}
+                mov     r9, r0
+                mov     r12, r0
+                mov     r11, r1
+                movs    r2, #0
+                movs    r3, #0
+
+sqr_column      mov     r8, r9
+                mov     r1, r12
+                b       sqr_test
+
+sqr_inner       mov     r0, r8
+                ldm     r0!, {r4}               ; a = x[j]
+                mov     r8, r0
+                ldr     r5, [r1]
+                subs    r1, #4
+                lsls    r5, r5, #1              ; b = 2 * x[i - j] < 2^31
+                uxth    r6, r4                  ; al
+                lsrs    r4, r4, #16             ; ah
+                uxth    r7, r5                  ; bl
+                lsrs    r5, r5, #16             ; bh
+                movs    r0, r6
+                muls    r0, r7, r0              ; al * bl
+                muls    r7, r4, r7              ; ah * bl
+                muls    r4, r5, r4              ; ah * bh
+                muls    r5, r6, r5              ; al * bh
+                adds    r7, r7, r5              ; mid < 2^31 + 2^30
+                adds    r2, r2, r0
+                adcs    r3, r3, r4
+                lsls    r0, r7, #16
+                lsrs    r7, r7, #16
+                adds    r2, r2, r0
+                adcs    r3, r3, r7
+
+sqr_test        cmp     r1, r8
+                bhi     sqr_inner
+                bne     sqr_store               ; odd column
+
+                ldr     r4, [r1]                ; a = x[i/2]
+                uxth    r6, r4                  ; al
+                lsrs    r4, r4, #16             ; ah
+                movs    r7, r6
+                muls    r7, r6, r7              ; al * al
+                movs    r5, r4
+                muls    r5, r4, r5              ; ah * ah
+                muls    r6, r4, r6              ; al * ah
+                lsls    r6, r6, #1              ; mid < 2^31
+                adds    r2, r2, r7
+                adcs    r3, r3, r5
+                lsls    r0, r6, #16
+                lsrs    r6, r6, #16
+                adds    r2, r2, r0
+                adcs    r3, r3, r6
+
+sqr_store       lsls    r4, r2, #2
+                lsrs    r4, r4, #2
+                mov     r0, r11
+                stm     r0!, {r4}
+                mov     r11, r0
+                lsrs    r2, r2, #30
+                lsls    r4, r3, #2
+                orrs    r2, r2, r4
+                lsrs    r3, r3, #30
+
+                ldr     r4, [sp]
+                mov     r0, r12
+                cmp     r0, r4
+                bhs     sqr_upper
+                adds    r0, #4
+                mov     r12, r0
+                b       sqr_column
+
+sqr_upper       mov     r0, r9
+                cmp     r0, r4
+                beq     sqr_done
+                adds    r0, #4
+                mov     r9, r0
+                b       sqr_column
+
+sqr_done        mov     r0, r11
+                str     r2, [r0]                ; res[17]
+                add     sp, sp, #4
+                pop     {r4-r7}
+                mov     r8, r4
+                mov     r9, r5
+                mov     r10, r6
+                mov     r11, r7
+                pop     {r4-r7, pc}
+
+                ENDP
+
+; void bn_multiply_reduce_step_m0(uint32_t res[18], const bignum256 *prime, uint32_t i)
+;
+; The C version keeps its running sum biased by 2^61 to stay unsigned,
+; here r3:r2 is a signed sum shifted arithmetically, which yields the
+; same limbs.
+;
+; r4 = coef & 0xFFFF, r5 = coef >> 16
+; r8 = &prime[9]
+
+bn_multiply_reduce_step_m0 PROC
+                EXPORT  bn_multiply_reduce_step_m0
+
+                push    {r4-r7, lr}
+                mov     r4, r8
+                push    {r4}
+                lsls    r2, r2, #2
+                adds    r2, r0, r2              ; &res[i]
+                ldr     r4, [r2]
+                ldr     r5, [r2, #4]
+                lsrs    r4, r4, #16
+                lsls    r5, r5, #14
+                adds    r5, r4, r5              ; coef < 2^31
+                uxth    r4, r5
+                lsrs    r5, r5, #16
+                movs    r0, r2
+                subs    r0, #32                 ; &res[i - 8]
+                movs    r2, r1
+                adds    r2, #36
+                mov     r8, r2
+                movs    r2, #0
+                movs    r3, #0
+
+red_loop        ldr     r6, [r1]                ; p = prime[j]
+                uxth    r7, r6                  ; pl
+                lsrs    r6, r6, #16             ; ph
+                muls    r7, r5, r7              ; pl * ch
+                muls    r6, r4, r6              ; ph * cl
+                adds    r7, r7, r6              ; mid < 2^31 + 2^30
+                lsls    r6, r7, #16
+                lsrs    r7, r7, #16
+                subs    r2, r2, r6
+                sbcs    r3, r3, r7
+                ldm     r1!, {r6}
+                uxth    r7, r6                  ; pl
+                lsrs    r6, r6, #16             ; ph
+                muls    r7, r4, r7              ; pl * cl
+                muls    r6, r5, r6              ; ph * ch
+                subs    r2, r2, r7
+                sbcs    r3, r3, r6
+                ldr     r6, [r0]
+                movs    r7, #0
+                adds    r2, r2, r6
+                adcs    r3, r3, r7
+                lsls    r6, r2, #2
+                lsrs    r6, r6, #2
+                stm     r0!, {r6}               ; res[i - 8 + j]
+                lsrs    r2, r2, #30
+                lsls    r6, r3, #2
+                orrs    r2, r2, r6
+                asrs    r3, r3, #30
+                cmp     r1, r8
+                bne     red_loop
+
+                ldr     r6, [r0]
+                adds    r6, r6, r2
+                lsls    r6, r6, #2
+                lsrs    r6, r6, #2
+                str     r6, [r0]                ; res[i + 1]
+                pop     {r4}
+                mov     r8, r4
+                pop     {r4-r7, pc}
+
+                ENDP
+
+                END
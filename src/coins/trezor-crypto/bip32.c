@@ -39,6 +39,22 @@
 
 #include "console.h"
 
+// The derivations take the parent's chain code as HMAC-SHA512 key blocks
+// compressed by hmac_sha512_prepare (opad and ipad digest), so that a parent
+// prepared once, kept in the cache or shared by a batch, saves two SHA-512
+// compressions for every further child.
+
+// constant time, chain codes are secret
+static bool hdnode_chain_code_equal(const uint8_t *a, const uint8_t *b)
+{
+	uint8_t diff = 0;
+	int k;
+	for (k = 0; k < 32; k++) {
+		diff |= a[k] ^ b[k];
+	}
+	return diff == 0;
+}
+
 int hdnode_from_xpub(uint32_t depth, uint32_t child_num, const uint8_t *chain_code, const uint8_t *public_key, const char* curve, HDNode *out)
 {
 	const curve_info *info = get_curve_by_name(curve);
@@ -92,6 +108,7 @@ int hdnode_from_xprv(uint32_t depth, uint32_t child_num, const uint8_t *chain_co
 int hdnode_from_seed(const uint8_t *seed, int seed_len, const char* curve, HDNode *out)
 {
 	uint8_t I[32 + 32];
+	const uint64_t *kd;
 	memset(out, 0, sizeof(HDNode));
 	out->depth = 0;
 	out->child_num = 0;
@@ -99,8 +116,8 @@ int hdnode_from_seed(const uint8_t *seed, int seed_len, const char* curve, HDNod
 	if (out->curve == 0) {
 		return 0;
 	}
-	hmac_sha512((const uint8_t*) out->curve->bip32_name,
-				strlen(out->curve->bip32_name), seed, seed_len, I);
+	kd = out->curve->bip32_key_digests;
+	hmac_sha512_prepared(kd, kd + 8, seed, seed_len, I);
 
 	if (out->curve->params) {
 		bignum256 a;
@@ -110,8 +127,7 @@ int hdnode_from_seed(const uint8_t *seed, int seed_len, const char* curve, HDNod
 				&& bn_is_less(&a, &out->curve->params->order)) { // < order
 				break;
 			}
-			hmac_sha512((const uint8_t*) out->curve->bip32_name,
-						strlen(out->curve->bip32_name), I, sizeof(I), I);
+			hmac_sha512_prepared(kd, kd + 8, I, sizeof(I), I);
 		}
 		MEMSET_BZERO(&a, sizeof(a));
 	}
@@ -128,14 +144,13 @@ uint32_t hdnode_fingerprint(HDNode *node)
 	uint32_t fingerprint;
 
 	hdnode_fill_public_key(node);
-	sha256_Raw(node->public_key, 33, digest);
-	ripemd160(digest, 32, digest);
+	hash160(node->public_key, 33, digest);
 	fingerprint = (digest[0] << 24) + (digest[1] << 16) + (digest[2] << 8) + digest[3];
 	MEMSET_BZERO(digest, sizeof(digest));
 	return fingerprint;
 }
 
-int hdnode_private_ckd(HDNode *inout, uint32_t i)
+static int hdnode_private_ckd_prepared(HDNode *inout, uint32_t i, const uint64_t *opad_digest, const uint64_t *ipad_digest)
 {
 	uint8_t data[1 + 32 + 4];
 	uint8_t I[32 + 32];
@@ -155,7 +170,7 @@ int hdnode_private_ckd(HDNode *inout, uint32_t i)
 
 	bn_read_be(inout->private_key, &a);
 
-	hmac_sha512(inout->chain_code, 32, data, sizeof(data), I);
+	hmac_sha512_prepared(opad_digest, ipad_digest, data, sizeof(data), I);
 	if (inout->curve->params) {
 		while (true) {
 			bool failed = false;
@@ -177,7 +192,7 @@ int hdnode_private_ckd(HDNode *inout, uint32_t i)
 
 			data[0] = 1;
 			memcpy(data + 1, I + 32, 32);
-			hmac_sha512(inout->chain_code, 32, data, sizeof(data), I);
+			hmac_sha512_prepared(opad_digest, ipad_digest, data, sizeof(data), I);
 		}
 	} else {
 		memcpy(inout->private_key, I, 32);
@@ -196,7 +211,20 @@ int hdnode_private_ckd(HDNode *inout, uint32_t i)
 	return 1;
 }
 
-int hdnode_public_ckd_cp(const ecdsa_curve *curve, const curve_point *parent, const uint8_t *parent_chain_code, uint32_t i, curve_point *child, uint8_t *child_chain_code) {
+int hdnode_private_ckd(HDNode *inout, uint32_t i)
+{
+	uint64_t opad_digest[8], ipad_digest[8];
+	int ret;
+
+	hmac_sha512_prepare(inout->chain_code, 32, opad_digest, ipad_digest);
+	ret = hdnode_private_ckd_prepared(inout, i, opad_digest, ipad_digest);
+	MEMSET_BZERO(opad_digest, sizeof(opad_digest));
+	MEMSET_BZERO(ipad_digest, sizeof(ipad_digest));
+	return ret;
+}
+
+static int hdnode_public_ckd_cp_prepared(const ecdsa_curve *curve, const curve_point *parent, const uint64_t *opad_digest, const uint64_t *ipad_digest, uint32_t i, curve_point *child, uint8_t *child_chain_code)
+{
 	uint8_t data[1 + 32 + 4];
 	uint8_t I[32 + 32];
 	bignum256 c;
@@ -210,11 +238,15 @@ int hdnode_public_ckd_cp(const ecdsa_curve *curve, const curve_point *parent, co
 	write_be(data + 33, i);
 
 	while (true) {
-		hmac_sha512(parent_chain_code, 32, data, sizeof(data), I);
+		hmac_sha512_prepared(opad_digest, ipad_digest, data, sizeof(data), I);
 		bn_read_be(I, &c);
 		if (bn_is_less(&c, &curve->order)) { // < order
-			scalar_multiply(curve, &c, child); // b = c * G
-			point_add(curve, parent, child);       // b = a + b
+			// b = c * G + a with a single inversion, the general point
+			// addition only for the cases the jacobian sum does not handle
+			if (!scalar_multiply_add_batch(curve, &c, parent, child, 1)) {
+				scalar_multiply(curve, &c, child); // b = c * G
+				point_add(curve, parent, child);       // b = a + b
+			}
 			if (!point_is_infinity(child)) {
 				if (child_chain_code) {
 					memcpy(child_chain_code, I + 32, 32);
@@ -233,14 +265,52 @@ int hdnode_public_ckd_cp(const ecdsa_curve *curve, const curve_point *parent, co
 	}
 }
 
-int hdnode_public_ckd(HDNode *inout, uint32_t i)
+int hdnode_public_ckd_cp(const ecdsa_curve *curve, const curve_point *parent, const uint8_t *parent_chain_code, uint32_t i, curve_point *child, uint8_t *child_chain_code) {
+	uint64_t opad_digest[8], ipad_digest[8];
+	int ret;
+
+	if (i & 0x80000000) { // private derivation
+		return 0;
+	}
+	hmac_sha512_prepare(parent_chain_code, 32, opad_digest, ipad_digest);
+	ret = hdnode_public_ckd_cp_prepared(curve, parent, opad_digest, ipad_digest, i, child, child_chain_code);
+	MEMSET_BZERO(opad_digest, sizeof(opad_digest));
+	MEMSET_BZERO(ipad_digest, sizeof(ipad_digest));
+	return ret;
+}
+
+// The parent of the last public derivation is kept decompressed, so that
+// consecutive children of one parent (address ranges, change outputs) do
+// not repeat the square root of ecdsa_read_pubkey.
+static struct {
+	const ecdsa_curve *curve;
+	uint8_t public_key[33];
+	curve_point point;
+} public_ckd_parent;
+
+static int hdnode_read_parent_point(const ecdsa_curve *curve, const uint8_t *public_key, curve_point *parent)
+{
+	if (public_ckd_parent.curve != curve ||
+	    memcmp(public_ckd_parent.public_key, public_key, 33) != 0) {
+		public_ckd_parent.curve = 0;
+		if (!ecdsa_read_pubkey(curve, public_key, &public_ckd_parent.point)) {
+			return 0;
+		}
+		public_ckd_parent.curve = curve;
+		memcpy(public_ckd_parent.public_key, public_key, 33);
+	}
+	memcpy(parent, &public_ckd_parent.point, sizeof(curve_point));
+	return 1;
+}
+
+static int hdnode_public_ckd_prepared(HDNode *inout, uint32_t i, const uint64_t *opad_digest, const uint64_t *ipad_digest)
 {
 	curve_point parent, child;
 
-	if (!ecdsa_read_pubkey(inout->curve->params, inout->public_key, &parent)) {
+	if (!hdnode_read_parent_point(inout->curve->params, inout->public_key, &parent)) {
 		return 0;
 	}
-	if (!hdnode_public_ckd_cp(inout->curve->params, &parent, inout->chain_code, i, &child, inout->chain_code)) {
+	if (!hdnode_public_ckd_cp_prepared(inout->curve->params, &parent, opad_digest, ipad_digest, i, &child, inout->chain_code)) {
 		return 0;
 	}
 	memset(inout->private_key, 0, 32);
@@ -256,6 +326,96 @@ int hdnode_public_ckd(HDNode *inout, uint32_t i)
 	return 1;
 }
 
+int hdnode_public_ckd(HDNode *inout, uint32_t i)
+{
+	uint64_t opad_digest[8], ipad_digest[8];
+	int ret;
+
+	hmac_sha512_prepare(inout->chain_code, 32, opad_digest, ipad_digest);
+	ret = hdnode_public_ckd_prepared(inout, i, opad_digest, ipad_digest);
+	MEMSET_BZERO(opad_digest, sizeof(opad_digest));
+	MEMSET_BZERO(ipad_digest, sizeof(ipad_digest));
+	return ret;
+}
+
+// Derive the public children i[j] of the nodes nodes[j], 0 <= j < n, in
+// place like hdnode_public_ckd.  Up to 4 children share one field inversion
+// (see scalar_multiply_add_batch), which makes this considerably cheaper
+// than n calls of hdnode_public_ckd.  A node that cannot be derived is
+// left unchanged, the function returns 0 in this case and 1 otherwise.
+int hdnode_public_ckd_batch(HDNode *const *nodes, const uint32_t *i, int n)
+{
+	curve_point parent[4], child[4];
+	bignum256 c[4];
+	uint8_t chain_code[4][32];
+	uint8_t data[1 + 32 + 4];
+	uint8_t I[32 + 32];
+	uint64_t opad_digest[8], ipad_digest[8];
+	uint8_t key_chain_code[32];
+	bool key_set = false;
+	const ecdsa_curve *curve;
+	HDNode *node;
+	int j, k, cnt, ok = 1;
+
+	for (j = 0; j < n; j += cnt) {
+		cnt = (n - j < 4) ? n - j : 4;
+		curve = nodes[j]->curve->params;
+		for (k = 0; k < cnt; k++) {
+			node = nodes[j + k];
+			if (node->curve->params != curve || (i[j + k] & 0x80000000)) {
+				break;
+			}
+			if (!hdnode_read_parent_point(curve, node->public_key, &parent[k])) {
+				break;
+			}
+			data[0] = 0x02 | (parent[k].y.val[0] & 0x01);
+			bn_write_be(&parent[k].x, data + 1);
+			write_be(data + 33, i[j + k]);
+			// siblings share the parent's key blocks
+			if (!key_set || !hdnode_chain_code_equal(key_chain_code, node->chain_code)) {
+				hmac_sha512_prepare(node->chain_code, 32, opad_digest, ipad_digest);
+				memcpy(key_chain_code, node->chain_code, 32);
+				key_set = true;
+			}
+			hmac_sha512_prepared(opad_digest, ipad_digest, data, sizeof(data), I);
+			bn_read_be(I, &c[k]);
+			if (!bn_is_less(&c[k], &curve->order)) { // >= order
+				break;
+			}
+			memcpy(chain_code[k], I + 32, 32);
+		}
+		if (k < cnt || !scalar_multiply_add_batch(curve, c, parent, child, cnt)) {
+			// invalid input or one of the (very unlikely) cases that
+			// hdnode_public_ckd_cp handles by retrying
+			for (k = 0; k < cnt; k++) {
+				ok &= hdnode_public_ckd(nodes[j + k], i[j + k]);
+			}
+			continue;
+		}
+		for (k = 0; k < cnt; k++) {
+			node = nodes[j + k];
+			memset(node->private_key, 0, 32);
+			node->depth++;
+			node->child_num = i[j + k];
+			node->public_key[0] = 0x02 | (child[k].y.val[0] & 0x01);
+			bn_write_be(&child[k].x, node->public_key + 1);
+			memcpy(node->chain_code, chain_code[k], 32);
+		}
+	}
+
+	// Wipe all stack data.
+	MEMSET_BZERO(parent, sizeof(parent));
+	MEMSET_BZERO(child, sizeof(child));
+	MEMSET_BZERO(c, sizeof(c));
+	MEMSET_BZERO(chain_code, sizeof(chain_code));
+	MEMSET_BZERO(data, sizeof(data));
+	MEMSET_BZERO(I, sizeof(I));
+	MEMSET_BZERO(opad_digest, sizeof(opad_digest));
+	MEMSET_BZERO(ipad_digest, sizeof(ipad_digest));
+	MEMSET_BZERO(key_chain_code, sizeof(key_chain_code));
+	return ok;
+}
+
 void hdnode_public_ckd_address_optimized(const curve_point *pub, const uint8_t *chain_code, uint32_t i, uint32_t version, char *addr, int addrsize, int addrformat)
 {
 	uint8_t child_pubkey[33];
@@ -276,74 +436,286 @@ void hdnode_public_ckd_address_optimized(const curve_point *pub, const uint8_t *
 }
 
 #if USE_BIP32_CACHE
-static bool private_ckd_cache_root_set = false;
-static HDNode private_ckd_cache_root;
-static int private_ckd_cache_index = 0;
+// Roots, derived nodes and derived public keys are kept in small tables
+// with least recently used eviction.  used == 0 marks a free entry, other
+// values are stamps of bip32_cache_clock.  Nodes and public keys refer to
+// their root by index; replacing a root drops everything derived from it.
+static uint32_t bip32_cache_clock = 0;
+static bip32_cache_stats bip32_cache_counters;
 
 static struct {
-	bool set;
+	uint32_t used;
+	HDNode node;
+} private_ckd_cache_root[BIP32_CACHE_ROOTS];
+
+static struct {
+	uint32_t used;
+	int root;
 	size_t depth;
 	uint32_t i[BIP32_CACHE_MAXDEPTH];
 	HDNode node;
+	// the node's chain code prepared as HMAC key for its children
+	uint64_t opad_digest[8];
+	uint64_t ipad_digest[8];
 } private_ckd_cache[BIP32_CACHE_SIZE];
 
-int hdnode_private_ckd_cached(HDNode *inout, const uint32_t *i, size_t i_count, uint32_t *fingerprint)
+// the chain code is kept for hdnode_public_ckd_cached, which returns
+// the whole public node from the entry
+static struct {
+	uint32_t used;
+	int root;
+	size_t depth;
+	uint32_t i[BIP32_CACHE_MAXDEPTH];
+	uint8_t chain_code[32];
+	uint8_t public_key[33];
+} public_key_cache[BIP32_PUBKEY_CACHE_SIZE];
+
+void bip32_cache_clear(void)
 {
-	if (i_count == 0) {
-		// no way how to compute parent fingerprint
-		return 1;
+	bip32_cache_clock = 0;
+	MEMSET_BZERO(private_ckd_cache_root, sizeof(private_ckd_cache_root));
+	MEMSET_BZERO(private_ckd_cache, sizeof(private_ckd_cache));
+	MEMSET_BZERO(public_key_cache, sizeof(public_key_cache));
+}
+
+const bip32_cache_stats *bip32_cache_get_stats(void)
+{
+	return &bip32_cache_counters;
+}
+
+static int private_ckd_cache_find_root(const HDNode *root)
+{
+	int j, r;
+	for (j = 0; j < BIP32_CACHE_ROOTS; j++) {
+		if (private_ckd_cache_root[j].used &&
+		    memcmp(&(private_ckd_cache_root[j].node), root, sizeof(HDNode)) == 0) {
+			private_ckd_cache_root[j].used = ++bip32_cache_clock;
+			return j;
+		}
+	}
+	// replace the least recently used root and everything derived from it
+	r = 0;
+	for (j = 1; j < BIP32_CACHE_ROOTS; j++) {
+		if (private_ckd_cache_root[j].used < private_ckd_cache_root[r].used) r = j;
 	}
-	if (i_count == 1) {
-		if (fingerprint) {
-			*fingerprint = hdnode_fingerprint(inout);
+	for (j = 0; j < BIP32_CACHE_SIZE; j++) {
+		if (private_ckd_cache[j].root == r) {
+			MEMSET_BZERO(&(private_ckd_cache[j]), sizeof(private_ckd_cache[j]));
+		}
+	}
+	for (j = 0; j < BIP32_PUBKEY_CACHE_SIZE; j++) {
+		if (public_key_cache[j].root == r) {
+			MEMSET_BZERO(&(public_key_cache[j]), sizeof(public_key_cache[j]));
 		}
-		if (hdnode_private_ckd(inout, i[0]) == 0) return 0;
-		return 1;
 	}
+	memcpy(&(private_ckd_cache_root[r].node), root, sizeof(HDNode));
+	private_ckd_cache_root[r].used = ++bip32_cache_clock;
+	return r;
+}
+
+static int private_ckd_cache_insert(int root, const uint32_t *i, size_t depth, const HDNode *node)
+{
+	int j, lru = 0;
+	for (j = 1; j < BIP32_CACHE_SIZE; j++) {
+		if (private_ckd_cache[j].used < private_ckd_cache[lru].used) lru = j;
+	}
+	j = lru;
+	memset(&(private_ckd_cache[j]), 0, sizeof(private_ckd_cache[j]));
+	private_ckd_cache[j].used = ++bip32_cache_clock;
+	private_ckd_cache[j].root = root;
+	private_ckd_cache[j].depth = depth;
+	memcpy(private_ckd_cache[j].i, i, depth * sizeof(uint32_t));
+	memcpy(&(private_ckd_cache[j].node), node, sizeof(HDNode));
+	hmac_sha512_prepare(node->chain_code, 32, private_ckd_cache[j].opad_digest, private_ckd_cache[j].ipad_digest);
+	return j;
+}
+
+static int public_key_cache_find(int root, const uint32_t *i, size_t i_count)
+{
+	int j;
+	for (j = 0; j < BIP32_PUBKEY_CACHE_SIZE; j++) {
+		if (public_key_cache[j].used &&
+		    public_key_cache[j].root == root &&
+		    public_key_cache[j].depth == i_count &&
+		    memcmp(public_key_cache[j].i, i, i_count * sizeof(uint32_t)) == 0) {
+			return j;
+		}
+	}
+	return -1;
+}
+
+static void public_key_cache_insert(int root, const uint32_t *i, size_t i_count, const HDNode *node)
+{
+	int j, lru = 0;
+	// replace the least recently used entry, free entries first
+	for (j = 1; j < BIP32_PUBKEY_CACHE_SIZE; j++) {
+		if (public_key_cache[j].used < public_key_cache[lru].used) lru = j;
+	}
+	j = lru;
+	memset(&(public_key_cache[j]), 0, sizeof(public_key_cache[j]));
+	public_key_cache[j].used = ++bip32_cache_clock;
+	public_key_cache[j].root = root;
+	public_key_cache[j].depth = i_count;
+	memcpy(public_key_cache[j].i, i, i_count * sizeof(uint32_t));
+	memcpy(public_key_cache[j].chain_code, node->chain_code, 32);
+	memcpy(public_key_cache[j].public_key, node->public_key, 33);
+}
+
+// fill the public key of the node derived along i from the cache, or
+// compute it and add it to the cache
+static void public_key_cache_fill(int root, HDNode *node, const uint32_t *i, size_t i_count)
+{
+	int j = public_key_cache_find(root, i, i_count);
+	if (j >= 0) {
+		public_key_cache[j].used = ++bip32_cache_clock;
+		memcpy(node->public_key, public_key_cache[j].public_key, 33);
+		bip32_cache_counters.pubkey_hits++;
+		return;
+	}
+	bip32_cache_counters.pubkey_misses++;
+	hdnode_fill_public_key(node);
+	public_key_cache_insert(root, i, i_count, node);
+}
+
+// the public key is needed for public derivation and for the fingerprint,
+// keep it in the cached node (entry j, -1 for the root) for the next call
+static void private_ckd_cache_fill_public_key(int j, HDNode *node)
+{
+	hdnode_fill_public_key(node);
+	if (j >= 0) {
+		memcpy(private_ckd_cache[j].node.public_key, node->public_key, 33);
+	}
+}
+
+// derive the node at depth n of path i from the root, starting at the
+// deepest cached ancestor and caching every intermediate node; returns the
+// cache entry of the result, -1 for the root itself or -2 on failure
+// derive the child i of the node in cache entry j (-1 for the root),
+// entries have the key blocks of their chain code ready
+static int private_ckd_cache_derive(int j, HDNode *node, uint32_t i)
+{
+	if (j < 0) {
+		return hdnode_private_ckd(node, i);
+	}
+	return hdnode_private_ckd_prepared(node, i, private_ckd_cache[j].opad_digest, private_ckd_cache[j].ipad_digest);
+}
 
-	bool found = false;
-	// if root is not set or not the same
-	if (!private_ckd_cache_root_set || memcmp(&private_ckd_cache_root, inout, sizeof(HDNode)) != 0) {
-		// clear the cache
-		private_ckd_cache_index = 0;
-		memset(private_ckd_cache, 0, sizeof(private_ckd_cache));
-		// setup new root
-		memcpy(&private_ckd_cache_root, inout, sizeof(HDNode));
-		private_ckd_cache_root_set = true;
+static int private_ckd_cache_walk(int root, HDNode *inout, const uint32_t *i, size_t n)
+{
+	size_t depth = 0, k;
+	int j, found = -1;
+
+	for (j = 0; j < BIP32_CACHE_SIZE; j++) {
+		if (private_ckd_cache[j].used &&
+		    private_ckd_cache[j].root == root &&
+		    private_ckd_cache[j].depth > depth &&
+		    private_ckd_cache[j].depth <= n &&
+		    memcmp(private_ckd_cache[j].i, i, private_ckd_cache[j].depth * sizeof(uint32_t)) == 0) {
+			found = j;
+			depth = private_ckd_cache[j].depth;
+		}
+	}
+	if (found >= 0) {
+		memcpy(inout, &(private_ckd_cache[found].node), sizeof(HDNode));
+		private_ckd_cache[found].used = ++bip32_cache_clock;
+	}
+	if (depth == n) {
+		bip32_cache_counters.hits++;
 	} else {
-		// try to find parent
-		int j;
-		for (j = 0; j < BIP32_CACHE_SIZE; j++) {
-			if (private_ckd_cache[j].set &&
-			    private_ckd_cache[j].depth == i_count - 1 &&
-			    memcmp(private_ckd_cache[j].i, i, (i_count - 1) * sizeof(uint32_t)) == 0 &&
-				private_ckd_cache[j].node.curve == inout->curve) {
-				memcpy(inout, &(private_ckd_cache[j].node), sizeof(HDNode));
-				found = true;
-				break;
-			}
+		bip32_cache_counters.misses++;
+	}
+
+	for (k = depth; k < n; k++) {
+		if ((i[k] & 0x80000000) == 0) {
+			private_ckd_cache_fill_public_key(found, inout);
 		}
+		if (private_ckd_cache_derive(found, inout, i[k]) == 0) return -2;
+		found = private_ckd_cache_insert(root, i, k + 1, inout);
 	}
+	return found;
+}
 
-	// else derive parent
-	if (!found) {
-		size_t k;
-		for (k = 0; k < i_count - 1; k++) {
+// Derive inout along the path i like repeated hdnode_private_ckd, the
+// public key of the result is filled in as well (from the cache if known).
+int hdnode_private_ckd_cached(HDNode *inout, const uint32_t *i, size_t i_count, uint32_t *fingerprint)
+{
+	size_t k;
+	int j, r;
+
+	if (i_count == 0) {
+		// no way how to compute parent fingerprint
+		hdnode_fill_public_key(inout);
+		return 1;
+	}
+	if (i_count == 1 || i_count > BIP32_CACHE_MAXDEPTH) {
+		// nothing to cache
+		for (k = 0; k < i_count; k++) {
+			if (fingerprint && k == i_count - 1) {
+				*fingerprint = hdnode_fingerprint(inout);
+			}
 			if (hdnode_private_ckd(inout, i[k]) == 0) return 0;
 		}
-		// and save it
-		memset(&(private_ckd_cache[private_ckd_cache_index]), 0, sizeof(private_ckd_cache[private_ckd_cache_index]));
-		private_ckd_cache[private_ckd_cache_index].set = true;
-		private_ckd_cache[private_ckd_cache_index].depth = i_count - 1;
-		memcpy(private_ckd_cache[private_ckd_cache_index].i, i, (i_count - 1) * sizeof(uint32_t));
-		memcpy(&(private_ckd_cache[private_ckd_cache_index].node), inout, sizeof(HDNode));
-		private_ckd_cache_index = (private_ckd_cache_index + 1) % BIP32_CACHE_SIZE;
+		hdnode_fill_public_key(inout);
+		return 1;
 	}
 
+	r = private_ckd_cache_find_root(inout);
+	j = private_ckd_cache_walk(r, inout, i, i_count - 1);
+	if (j < -1) return 0;
+
+	if ((i[i_count - 1] & 0x80000000) == 0 || fingerprint) {
+		private_ckd_cache_fill_public_key(j, inout);
+	}
 	if (fingerprint) {
 		*fingerprint = hdnode_fingerprint(inout);
 	}
-	if (hdnode_private_ckd(inout, i[i_count - 1]) == 0) return 0;
+	if (private_ckd_cache_derive(j, inout, i[i_count - 1]) == 0) return 0;
+
+	public_key_cache_fill(r, inout, i, i_count);
+
+	return 1;
+}
+
+// Same public node as hdnode_private_ckd_cached, its private key is cleared.
+// A non-hardened last step is a public derivation from the parent public key,
+// so the child private key is never computed.  Both routes cost one k*G for
+// the child; here the point addition shares its inversion with it (see
+// scalar_multiply_add_batch) and the decompressed parent is kept for its
+// siblings (hdnode_read_parent_point).
+int hdnode_public_ckd_cached(HDNode *inout, const uint32_t *i, size_t i_count)
+{
+	int j, p, r;
+
+	if (i_count < 2 || i_count > BIP32_CACHE_MAXDEPTH ||
+	    (i[i_count - 1] & 0x80000000) || !inout->curve->params) {
+		if (hdnode_private_ckd_cached(inout, i, i_count, NULL) == 0) return 0;
+		memset(inout->private_key, 0, 32);
+		return 1;
+	}
+
+	r = private_ckd_cache_find_root(inout);
+	p = public_key_cache_find(r, i, i_count);
+	if (p >= 0) {
+		public_key_cache[p].used = ++bip32_cache_clock;
+		bip32_cache_counters.pubkey_hits++;
+		memset(inout->private_key, 0, 32);
+		inout->depth += i_count;
+		inout->child_num = i[i_count - 1];
+		memcpy(inout->chain_code, public_key_cache[p].chain_code, 32);
+		memcpy(inout->public_key, public_key_cache[p].public_key, 33);
+		return 1;
+	}
+	bip32_cache_counters.pubkey_misses++;
+
+	j = private_ckd_cache_walk(r, inout, i, i_count - 1);
+	if (j < -1) return 0;
+	private_ckd_cache_fill_public_key(j, inout);
+	if (j >= 0) {
+		if (hdnode_public_ckd_prepared(inout, i[i_count - 1], private_ckd_cache[j].opad_digest, private_ckd_cache[j].ipad_digest) == 0) return 0;
+	} else {
+		if (hdnode_public_ckd(inout, i[i_count - 1]) == 0) return 0;
+	}
+	public_key_cache_insert(r, i, i_count, inout);
 
 	return 1;
 }
@@ -33,6 +33,7 @@
 typedef struct {
 	const char *bip32_name;    // string for generating BIP32 xprv from seed
 	const ecdsa_curve *params; // ecdsa curve parameters, null for ed25519
+	const uint64_t *bip32_key_digests; // bip32_name as HMAC-SHA512 key, opad and ipad digest (hmac_sha512_prepare)
 } curve_info;
 
 typedef struct {
@@ -58,10 +59,20 @@ int hdnode_public_ckd_cp(const ecdsa_curve *curve, const curve_point *parent, co
 
 int hdnode_public_ckd(HDNode *inout, uint32_t i);
 
+int hdnode_public_ckd_batch(HDNode *const *nodes, const uint32_t *i, int n);
+
 void hdnode_public_ckd_address_optimized(const curve_point *pub, const uint8_t *chain_code, uint32_t i, uint32_t version, char *addr, int addrsize, int addrformat);
 
 #if USE_BIP32_CACHE
+typedef struct {
+	uint32_t hits, misses;               // parent node found / derived
+	uint32_t pubkey_hits, pubkey_misses; // public key found / computed
+} bip32_cache_stats;
+
 int hdnode_private_ckd_cached(HDNode *inout, const uint32_t *i, size_t i_count, uint32_t *fingerprint);
+int hdnode_public_ckd_cached(HDNode *inout, const uint32_t *i, size_t i_count);
+void bip32_cache_clear(void);
+const bip32_cache_stats *bip32_cache_get_stats(void);
 #endif
 
 uint32_t hdnode_fingerprint(HDNode *node);
@@ -238,6 +238,53 @@ void jacobian_to_curve(const jacobian_curve_point *jp, curve_point *p, const big
 	bn_mod(&p->y, prime);
 }
 
+// convert n points to affine coordinates with a single inversion.
+// On entry p[i] holds the jacobian x and y coordinates and z[i] the
+// z coordinate of the i-th point, tmp is scratch space for n numbers.
+// All z[i] must be non-zero modulo prime.
+static void jacobian_to_curve_batch(curve_point *p, bignum256 *z, bignum256 *tmp, int n, const bignum256 *prime) {
+	int i;
+	bn_inverse_batch(z, tmp, n, prime);
+	for (i = 0; i < n; i++) {
+		tmp[i] = z[i];
+		bn_multiply(&tmp[i], &tmp[i], prime);
+		// tmp[i] = z^-2
+		bn_multiply(&tmp[i], &z[i], prime);
+		// z[i] = z^-3
+		bn_multiply(&tmp[i], &p[i].x, prime);
+		bn_multiply(&z[i], &p[i].y, prime);
+		bn_mod(&p[i].x, prime);
+		bn_mod(&p[i].y, prime);
+	}
+	MEMSET_BZERO(z, n * sizeof(bignum256));
+	MEMSET_BZERO(tmp, n * sizeof(bignum256));
+}
+
+// field multiplication x = k * x and squaring x = x * x for the point
+// arithmetic, secp256k1 has a prime of special form that allows a
+// cheaper reduction.
+static inline void fe_multiply(const ecdsa_curve *curve, const bignum256 *k, bignum256 *x)
+{
+#if USE_SECP256K1_REDUCTION
+	if (curve == &secp256k1) {
+		bn_multiply_secp256k1(k, x);
+		return;
+	}
+#endif
+	bn_multiply(k, x, &curve->prime);
+}
+
+static inline void fe_square(const ecdsa_curve *curve, bignum256 *x)
+{
+#if USE_SECP256K1_REDUCTION
+	if (curve == &secp256k1) {
+		bn_square_secp256k1(x);
+		return;
+	}
+#endif
+	bn_multiply(x, x, &curve->prime);
+}
+
 void point_jacobian_add(const curve_point *p1, jacobian_curve_point *p2, const ecdsa_curve *curve) {
 	bignum256 r, h, r2;
 	bignum256 hcby, hsqx;
@@ -281,17 +328,17 @@ void point_jacobian_add(const curve_point *p1, jacobian_curve_point *p2, const e
 	 */
 
 	xz = p2->z;
-	bn_multiply(&xz, &xz, prime); // xz = z2^2
+	fe_square(curve, &xz); // xz = z2^2
 	yz = p2->z;
-	bn_multiply(&xz, &yz, prime); // yz = z2^3
+	fe_multiply(curve, &xz, &yz); // yz = z2^3
 	
 	if (a != 0) {
 		az  = xz;
-		bn_multiply(&az, &az, prime);   // az = z2^4
+		fe_square(curve, &az);   // az = z2^4
 		bn_mult_k(&az, -a, prime);      // az = -az2^4
 	}
 	
-	bn_multiply(&p1->x, &xz, prime);        // xz = x1' = x1*z2^2;
+	fe_multiply(curve, &p1->x, &xz);        // xz = x1' = x1*z2^2;
 	h = xz;
 	bn_subtractmod(&h, &p2->x, &h, prime);
 	bn_fast_mod(&h, prime);
@@ -306,7 +353,7 @@ void point_jacobian_add(const curve_point *p1, jacobian_curve_point *p2, const e
 	// bn_fast_mod.
 	is_doubling = bn_is_equal(&h, prime);
 
-	bn_multiply(&p1->y, &yz, prime);        // yz = y1' = y1*z2^3;
+	fe_multiply(curve, &p1->y, &yz);        // yz = y1' = y1*z2^3;
 	bn_subtractmod(&yz, &p2->y, &r, prime);
 	// r = y1' - y2;
 
@@ -314,7 +361,7 @@ void point_jacobian_add(const curve_point *p1, jacobian_curve_point *p2, const e
 	// yz = y1' + y2
 
 	r2 = p2->x;
-	bn_multiply(&r2, &r2, prime);
+	fe_square(curve, &r2);
 	bn_mult_k(&r2, 3, prime);
 	
 	if (a != 0) {
@@ -327,31 +374,31 @@ void point_jacobian_add(const curve_point *p1, jacobian_curve_point *p2, const e
 
 	// hsqx = h^2
 	hsqx = h;
-	bn_multiply(&hsqx, &hsqx, prime);
+	fe_square(curve, &hsqx);
 
 	// hcby = h^3
 	hcby = h;
-	bn_multiply(&hsqx, &hcby, prime);
+	fe_multiply(curve, &hsqx, &hcby);
 
 	// hsqx = h^2 * (x1 + x2)
-	bn_multiply(&xz, &hsqx, prime);
+	fe_multiply(curve, &xz, &hsqx);
 
 	// hcby = h^3 * (y1 + y2)
-	bn_multiply(&yz, &hcby, prime);
+	fe_multiply(curve, &yz, &hcby);
 
 	// z3 = h*z2
-	bn_multiply(&h, &p2->z, prime);
+	fe_multiply(curve, &h, &p2->z);
 
 	// x3 = r^2 - h^2 (x1 + x2)
 	p2->x = r;
-	bn_multiply(&p2->x, &p2->x, prime);
+	fe_square(curve, &p2->x);
 	bn_subtractmod(&p2->x, &hsqx, &p2->x, prime);
 	bn_fast_mod(&p2->x, prime);
 
 	// y3 = 1/2 (r*(h^2 (x1 + x2) - 2x3) - h^3 (y1 + y2))
 	bn_subtractmod(&hsqx, &p2->x, &p2->y, prime);
 	bn_subtractmod(&p2->y, &p2->x, &p2->y, prime);
-	bn_multiply(&r, &p2->y, prime);
+	fe_multiply(curve, &r, &p2->y);
 	bn_subtractmod(&p2->y, &hcby, &p2->y, prime);
 	bn_mult_half(&p2->y, prime);
 	bn_fast_mod(&p2->y, prime);
@@ -387,28 +434,30 @@ void point_jacobian_double(jacobian_curve_point *p, const ecdsa_curve *curve) {
 	 */
 
 	m = p->x;
-	bn_multiply(&m, &m, prime);
+	fe_square(curve, &m);
 	bn_mult_k(&m, 3, prime);
 
-	az4 = p->z;
-	bn_multiply(&az4, &az4, prime);
-	bn_multiply(&az4, &az4, prime);
-	bn_mult_k(&az4, -curve->a, prime);
-	bn_subtractmod(&m, &az4, &m, prime);
+	if (curve->a != 0) {
+		az4 = p->z;
+		fe_square(curve, &az4);
+		fe_square(curve, &az4);
+		bn_mult_k(&az4, -curve->a, prime);
+		bn_subtractmod(&m, &az4, &m, prime);
+	}
 	bn_mult_half(&m, prime);
 
 	// msq = m^2
 	msq = m;
-	bn_multiply(&msq, &msq, prime);
+	fe_square(curve, &msq);
 	// ysq = y^2
 	ysq = p->y;
-	bn_multiply(&ysq, &ysq, prime);
+	fe_square(curve, &ysq);
 	// xysq = xy^2
 	xysq = p->x;
-	bn_multiply(&ysq, &xysq, prime);
+	fe_multiply(curve, &ysq, &xysq);
 
 	// z3 = yz
-	bn_multiply(&p->y, &p->z, prime);
+	fe_multiply(curve, &p->y, &p->z);
 
 	// x3 = m^2 - 2*xy^2
 	p->x = xysq;
@@ -419,12 +468,295 @@ void point_jacobian_double(jacobian_curve_point *p, const ecdsa_curve *curve) {
 
 	// y3 = m*(xy^2 - x3) - y^4
 	bn_subtractmod(&xysq, &p->x, &p->y, prime);
-	bn_multiply(&m, &p->y, prime);
-	bn_multiply(&ysq, &ysq, prime);
+	fe_multiply(curve, &m, &p->y);
+	fe_square(curve, &ysq);
 	bn_subtractmod(&p->y, &ysq, &p->y, prime);
 	bn_fast_mod(&p->y, prime);
 }
 
+// pmult[i] = (2*i+1) * p  for 0 <= i < n <= 8
+// The table is built with co-Z arithmetic (Meloni): 2p and the running
+// sum are always kept with the same z coordinate, so that an addition
+// needs no conversion, and each new z is the previous one times a known
+// factor h.  Hence a single inversion converts the whole table to affine
+// coordinates.  p must not be a point of order 2 (y = 0).
+static void point_odd_multiples(const ecdsa_curve *curve, const curve_point *p, curve_point *pmult, int n)
+{
+	int i;
+	bignum256 dx, dy, rx, ry, z, t, c, w1, w2;
+	bignum256 h[7];
+	const bignum256 *prime = &curve->prime;
+
+	assert (n <= 8);
+
+	// double p (with z = 1) to d = 2p and bring p to the new z = 2y:
+	// m = 3x^2 + a, s = 4xy^2
+	// d = (m^2 - 2s, m(s - dx) - 8y^4),  r = (s, 8y^4)
+	t = p->y;
+	fe_square(curve, &t);
+	// t = y^2
+	rx = p->x;
+	fe_multiply(curve, &t, &rx);
+	bn_mult_k(&rx, 4, prime);
+	// rx = s = 4xy^2
+	ry = t;
+	fe_square(curve, &ry);
+	bn_mult_k(&ry, 4, prime);
+	bn_mult_k(&ry, 2, prime);
+	// ry = 8y^4
+	c = p->x;
+	fe_square(curve, &c);
+	bn_mult_k(&c, 3, prime);
+	if (curve->a != 0) {
+		bn_subi(&c, -curve->a, prime);
+		bn_fast_mod(&c, prime);
+	}
+	// c = m = 3x^2 + a
+	dx = c;
+	fe_square(curve, &dx);
+	t = rx;
+	bn_mult_k(&t, 2, prime);
+	bn_subtractmod(&dx, &t, &dx, prime);
+	bn_fast_mod(&dx, prime);
+	// dx = m^2 - 2s
+	bn_subtractmod(&rx, &dx, &dy, prime);
+	fe_multiply(curve, &c, &dy);
+	bn_subtractmod(&dy, &ry, &dy, prime);
+	bn_fast_mod(&dy, prime);
+	// dy = m(s - dx) - 8y^4
+	z = p->y;
+	bn_mult_k(&z, 2, prime);
+
+	// (r, d) = (d + r, d) with a common z, see Meloni's ZADDU:
+	// h = dx - rx, c = h^2, w1 = dx * c, w2 = rx * c
+	// r = ((dy - ry)^2 - w1 - w2, (dy - ry)(w1 - rx') - dy(w1 - w2))
+	// d = (w1, dy(w1 - w2)),  z = z * h
+	for (i = 1; i < n; i++) {
+		bn_subtractmod(&dx, &rx, &h[i - 1], prime);
+		bn_fast_mod(&h[i - 1], prime);
+		c = h[i - 1];
+		fe_square(curve, &c);
+		w1 = dx;
+		fe_multiply(curve, &c, &w1);
+		w2 = rx;
+		fe_multiply(curve, &c, &w2);
+		bn_subtractmod(&dy, &ry, &t, prime);
+		bn_fast_mod(&t, prime);
+		// t = dy - ry
+		bn_subtractmod(&w1, &w2, &c, prime);
+		fe_multiply(curve, &dy, &c);
+		// c = dy(w1 - w2)
+		rx = t;
+		fe_square(curve, &rx);
+		bn_subtractmod(&rx, &w1, &rx, prime);
+		bn_fast_mod(&rx, prime);
+		bn_subtractmod(&rx, &w2, &rx, prime);
+		bn_fast_mod(&rx, prime);
+		bn_subtractmod(&w1, &rx, &ry, prime);
+		fe_multiply(curve, &t, &ry);
+		bn_subtractmod(&ry, &c, &ry, prime);
+		bn_fast_mod(&ry, prime);
+		dx = w1;
+		dy = c;
+		fe_multiply(curve, &h[i - 1], &z);
+		pmult[i].x = rx;
+		pmult[i].y = ry;
+	}
+
+	// z = z_{n-1}^-1 and z_{i-1}^-1 = z_i^-1 * h_i
+	bn_inverse(&z, prime);
+	for (i = n - 1; i > 0; i--) {
+		t = z;
+		fe_square(curve, &t);
+		fe_multiply(curve, &t, &pmult[i].x);
+		fe_multiply(curve, &z, &t);
+		fe_multiply(curve, &t, &pmult[i].y);
+		bn_mod(&pmult[i].x, prime);
+		bn_mod(&pmult[i].y, prime);
+		fe_multiply(curve, &h[i - 1], &z);
+	}
+	pmult[0] = *p;
+
+	MEMSET_BZERO(&z, sizeof(z));
+	MEMSET_BZERO(&t, sizeof(t));
+	MEMSET_BZERO(h, sizeof(h));
+}
+
+#if USE_ENDOMORPHISM
+
+// c = round(res / 2^384) for the 512 bit product res = k * g
+static void glv_round384(const uint32_t res[18], bignum256 *c)
+{
+	int i;
+	// bit 384 is bit 24 of limb 12
+	for (i = 0; i < 9; i++) {
+		c->val[i] = 0;
+	}
+	for (i = 0; i < 5; i++) {
+		c->val[i] = ((res[12 + i] >> 24) | (res[13 + i] << 6)) & 0x3fffffff;
+	}
+	c->val[5] = res[17] >> 24;
+	bn_addi(c, (res[12] >> 23) & 1);
+}
+
+// split k = k1 + k2 * lambda (mod order) with |k1|, |k2| < 2^128.
+// k1 and k2 are returned as absolute values, neg1 and neg2 are set
+// to 1 if the corresponding part is negative and to 0 otherwise.
+// The function is constant time.
+static void glv_split(const ecdsa_curve *curve, const bignum256 *k, bignum256 *k1, bignum256 *k2, int *neg1, int *neg2)
+{
+	const ecdsa_endomorphism *endo = curve->endo;
+	const bignum256 *order = &curve->order;
+	uint32_t res[18];
+	bignum256 c1, c2, t;
+
+	// c1 = round(k * g1 / 2^384),  c2 = round(k * g2 / 2^384)
+	bn_multiply_long(k, &endo->g1, res);
+	glv_round384(res, &c1);
+	bn_multiply_long(k, &endo->g2, res);
+	glv_round384(res, &c2);
+
+	// k2 = c1 * (-b1) + c2 * (-b2)
+	bn_multiply(&endo->minus_b1, &c1, order);
+	bn_multiply(&endo->minus_b2, &c2, order);
+	bn_addmod(&c1, &c2, order);
+	bn_mod(&c1, order);
+	*k2 = c1;
+
+	// k1 = k - k2 * lambda
+	t = c1;
+	bn_multiply(&endo->lambda, &t, order);
+	bn_mod(&t, order);
+	bn_subtractmod(k, &t, k1, order);
+	bn_fast_mod(k1, order);
+	bn_mod(k1, order);
+
+	// k > order/2 stands for the negative number k - order
+	*neg1 = bn_is_less(&curve->order_half, k1);
+	bn_subtract(order, k1, &t);
+	bn_cmov(k1, *neg1, &t, k1);
+	*neg2 = bn_is_less(&curve->order_half, k2);
+	bn_subtract(order, k2, &t);
+	bn_cmov(k2, *neg2, &t, k2);
+
+	MEMSET_BZERO(res, sizeof(res));
+	MEMSET_BZERO(&c1, sizeof(c1));
+	MEMSET_BZERO(&c2, sizeof(c2));
+	MEMSET_BZERO(&t, sizeof(t));
+}
+
+// p = table[index] for 0 <= index < n
+// All entries are read, so that the memory access pattern does not
+// depend on the (secret) index.
+static void point_select(const curve_point *table, int n, uint32_t index, curve_point *p)
+{
+	int j;
+	uint32_t cond;
+	for (j = 0; j < n; j++) {
+		cond = (((uint32_t)j ^ index) - 1) >> 31;
+		bn_cmov(&p->x, cond, &table[j].x, &p->x);
+		bn_cmov(&p->y, cond, &table[j].y, &p->y);
+	}
+}
+
+// res = k * p using the endomorphism of the curve:
+// k = k1 + k2 * lambda, so that k * p = k1 * p + k2 * phi(p) with
+// phi(x, y) = (beta * x, y).  Since k1 and k2 have only 128 bits, both
+// halves share a doubling chain of half the length.
+// This is constant time in the same sense as point_multiply.
+static void point_multiply_endo(const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res)
+{
+	int i, j;
+	int neg[2];
+	bignum256 a[2];
+	uint8_t win[2][33];
+	uint32_t skew[2], bits, sign, negmask;
+	curve_point pmult[8], pt;
+	jacobian_curve_point jres, jtmp;
+	const bignum256 *prime = &curve->prime;
+
+	// special case 0*p:  just return zero. We don't care about constant time.
+	if (bn_is_zero(k)) {
+		point_set_infinity(res);
+		return;
+	}
+
+	glv_split(curve, k, &a[0], &a[1], &neg[0], &neg[1]);
+
+	for (j = 0; j < 2; j++) {
+		// make a[j] odd, the skew is subtracted from the result at the end
+		skew[j] = (a[j].val[0] & 1) ^ 1;
+		a[j].val[0] += skew[j];
+		// add 2^132 and split into 33 odd digits |a[j][i]| < 16,
+		// the same way as in point_multiply:
+		//   a[j] = sum_{i=0..32} a[j][i] 16^i
+		a[j].val[4] += 1 << 12;
+		for (i = 0; i < 33; i++) {
+			win[j][i] = a[j].val[0] & 31;
+			bn_rshift(&a[j]);
+			bn_rshift(&a[j]);
+			bn_rshift(&a[j]);
+			bn_rshift(&a[j]);
+		}
+	}
+
+	// pmult[i] = (2*i+1) * p
+	point_odd_multiples(curve, p, pmult, 8);
+
+	for (i = 32; i >= 0; i--) {
+		if (i != 32) {
+			point_jacobian_double(&jres, curve);
+			point_jacobian_double(&jres, curve);
+			point_jacobian_double(&jres, curve);
+			point_jacobian_double(&jres, curve);
+		}
+		for (j = 0; j < 2; j++) {
+			bits = win[j][i];
+			sign = ((bits >> 4) & 1) - 1;
+			bits ^= sign;
+			bits &= 15;
+			point_select(pmult, 8, bits >> 1, &pt);
+			if (j == 1) {
+				bn_multiply(&curve->endo->beta, &pt.x, prime);
+				bn_mod(&pt.x, prime);
+			}
+			// sign of the digit times sign of the half
+			negmask = (uint32_t) -neg[j];
+			conditional_negate(sign ^ negmask, &pt.y, prime);
+			if (i == 32 && j == 0) {
+				curve_to_jacobian(&pt, &jres, prime);
+			} else {
+				point_jacobian_add(&pt, &jres, curve);
+			}
+		}
+	}
+
+	// subtract the skew: jres -= skew[0] * (+-p) + skew[1] * (+-phi(p))
+	for (j = 0; j < 2; j++) {
+		pt = pmult[0];
+		if (j == 1) {
+			bn_multiply(&curve->endo->beta, &pt.x, prime);
+			bn_mod(&pt.x, prime);
+		}
+		negmask = (uint32_t) -neg[j];
+		conditional_negate(~negmask, &pt.y, prime);
+		jtmp = jres;
+		point_jacobian_add(&pt, &jtmp, curve);
+		bn_cmov(&jres.x, skew[j], &jtmp.x, &jres.x);
+		bn_cmov(&jres.y, skew[j], &jtmp.y, &jres.y);
+		bn_cmov(&jres.z, skew[j], &jtmp.z, &jres.z);
+	}
+	jacobian_to_curve(&jres, res, prime);
+
+	MEMSET_BZERO(a, sizeof(a));
+	MEMSET_BZERO(win, sizeof(win));
+	MEMSET_BZERO(&pt, sizeof(pt));
+	MEMSET_BZERO(&jres, sizeof(jres));
+	MEMSET_BZERO(&jtmp, sizeof(jtmp));
+}
+
+#endif
+
 // res = k * p
 void point_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res)
 {
@@ -434,6 +766,13 @@ void point_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_po
 	//  Side Channel Attacks.
 	assert (bn_is_less(k, &curve->order));
 
+#if USE_ENDOMORPHISM
+	if (curve->endo) {
+		point_multiply_endo(curve, k, p, res);
+		return;
+	}
+#endif
+
 	int i, j;
 	bignum256 a;
 	uint32_t *aptr;
@@ -481,15 +820,7 @@ void point_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_po
 	// We compute |a[i]| * p in advance for all possible
 	// values of |a[i]| * p.  pmult[i] = (2*i+1) * p
 	// We compute p, 3*p, ..., 15*p and store it in the table pmult.
-	// store p^2 temporarily in pmult[7]
-	pmult[7] = *p;
-	point_double(curve, &pmult[7]);
-	// compute 3*p, etc by repeatedly adding p^2.
-	pmult[0] = *p;
-	for (i = 1; i < 8; i++) {
-		pmult[i] = pmult[7];
-		point_add(curve, &pmult[i-1], &pmult[i]);
-	}
+	point_odd_multiples(curve, p, pmult, 8);
 
 	// now compute  res = sum_{i=0..63} a[i] * 16^i * p step by step,
 	// starting with i = 63.
@@ -547,17 +878,63 @@ void point_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_po
 
 #if USE_PRECOMPUTED_CP
 
-// res = k * G
+#if (64 % PRECOMPUTED_CP_SPACING) != 0
+#error PRECOMPUTED_CP_SPACING must divide 64
+#endif
+
+// unpack one coordinate of a precomputed point
+static void cp_unpack(const uint32_t *w, bignum256 *a)
+{
+	int i, b, s;
+	uint32_t v;
+	for (i = 0; i < 8; i++) {
+		b = 30 * i;
+		s = b & 31;
+		v = w[b >> 5] >> s;
+		if (s > 2) {
+			v |= w[(b >> 5) + 1] << (32 - s);
+		}
+		a->val[i] = v & 0x3fffffff;
+	}
+	a->val[8] = w[7] >> 16;
+}
+
+// p = row[index] for 0 <= index < 8
+// All entries of the row are read, so that the memory access pattern
+// does not depend on the (secret) index.
+static void cp_select(const curve_point_packed *row, uint32_t index, curve_point *p)
+{
+	uint32_t x[8], y[8], mask;
+	int i, j;
+	for (i = 0; i < 8; i++) {
+		x[i] = y[i] = 0;
+	}
+	for (j = 0; j < 8; j++) {
+		mask = 0 - (((j ^ index) - 1) >> 31);
+		for (i = 0; i < 8; i++) {
+			x[i] |= row[j].x[i] & mask;
+			y[i] |= row[j].y[i] & mask;
+		}
+	}
+	cp_unpack(x, &p->x);
+	cp_unpack(y, &p->y);
+	MEMSET_BZERO(x, sizeof(x));
+	MEMSET_BZERO(y, sizeof(y));
+}
+
+// jres = k * G
 // k must be a normalized number with 0 <= k < curve->order
-void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *res)
+// returns 0 for k = 0 (jres is not set then) and 1 otherwise.
+static int scalar_multiply_jacobian(const ecdsa_curve *curve, const bignum256 *k, jacobian_curve_point *jres)
 {
 	assert (bn_is_less(k, &curve->order));
 
-	int i, j;
+	int i, j, r, t;
 	bignum256 a;
+	uint8_t win[64];
+	uint32_t bits, sign, nsign;
 	uint32_t is_even = (k->val[0] & 1) - 1;
-	uint32_t lowbits;
-	jacobian_curve_point jres;
+	curve_point pt;
 	const bignum256 *prime = &curve->prime;
 
 	// is_even = 0xffffffff if k is even, 0 otherwise.
@@ -578,8 +955,7 @@ void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *
 
 	// special case 0*G:  just return zero. We don't care about constant time.
 	if (!is_non_zero) {
-		point_set_infinity(res);
-		return;
+		return 0;
 	}
 
 	// Now a = k + 2^256 (mod curve->order) and a is odd.
@@ -593,46 +969,93 @@ void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *
 	// Since k = a - 2^256 (mod curve->order), we can compute
 	//   k*G = sum_{i=0..63} a[i] 16^i * G
 	//
-	// We have a big table curve->cp that stores all possible
-	// values of |a[i]| 16^i * G.
-	// curve->cp[i][j] = (2*j+1) * 16^i * G
-
-	// now compute  res = sum_{i=0..63} a[i] * 16^i * G step by step.
-	// initial res = |a[0]| * G.  Note that a[0] = a & 0xf if (a&0x10) != 0
-	// and - (16 - (a & 0xf)) otherwise.   We can compute this as
-	//   ((a ^ (((a >> 4) & 1) - 1)) & 0xf) >> 1
-	// since a is odd.
-	lowbits = a.val[0] & ((1 << 5) - 1);
-	lowbits ^= (lowbits >> 4) - 1;
-	lowbits &= 15;
-	curve_to_jacobian(&curve->cp[0][lowbits >> 1], &jres, prime);
-	for (i = 1; i < 64; i ++) {
-		// invariant res = sign(a[i-1]) sum_{j=0..i-1} (a[j] * 16^j * G)
-
+	// The table curve->cp only stores every S-th row (S is
+	// PRECOMPUTED_CP_SPACING) of all possible values of |a[i]| 16^i * G:
+	//   curve->cp[r][j] = (2*j+1) * 16^(r*S) * G
+	// Writing i = r*S + t we compute (comb method)
+	//   k*G = sum_{t=0..S-1} 16^t sum_r a[r*S+t] * curve->cp[r]
+	// by Horner's rule in t, i.e. with 4 doublings between the rounds.
+	//
+	// win[i] holds the 5 bits a >> (4*i).  a[i] is positive iff bit 4
+	// of win[i] is set and |a[i]| = 2 * index + 1 with
+	//   index = ((win ^ (((win >> 4) & 1) - 1)) & 0xf) >> 1
+	// since a[i] is odd.
+	for (i = 0; i < 64; i++) {
+		win[i] = a.val[0] & 31;
 		// shift a by 4 places.
 		for (j = 0; j < 8; j++) {
 			a.val[j] = (a.val[j] >> 4) | ((a.val[j + 1] & 0xf) << 26);
 		}
 		a.val[j] >>= 4;
-		// a = old(a)>>(4*i)
-		// a is even iff sign(a[i-1]) = -1
+	}
 
-		lowbits = a.val[0] & ((1 << 5) - 1);
-		lowbits ^= (lowbits >> 4) - 1;
-		lowbits &= 15;
-		// negate last result to make signs of this round and the
-		// last round equal.
-		conditional_negate((lowbits & 1) - 1, &jres.y, prime);
+	// sign = sign(last digit added)  (0xffffffff for negative, 0 for positive)
+	// invariant jres = (-1)^sign * (partial sum)
+	sign = 0;
+	for (t = PRECOMPUTED_CP_SPACING - 1; t >= 0; t--) {
+		if (t != PRECOMPUTED_CP_SPACING - 1) {
+			// the condition only depends on the iteration number and
+			// leaks no private information to a side-channel.
+			point_jacobian_double(jres, curve);
+			point_jacobian_double(jres, curve);
+			point_jacobian_double(jres, curve);
+			point_jacobian_double(jres, curve);
+		}
+		for (r = 0; r < 64 / PRECOMPUTED_CP_SPACING; r++) {
+			bits = win[r * PRECOMPUTED_CP_SPACING + t];
+			nsign = ((bits >> 4) & 1) - 1;
+			bits ^= nsign;
+			bits &= 15;
+			cp_select(curve->cp[r], bits >> 1, &pt);
+			if (t == PRECOMPUTED_CP_SPACING - 1 && r == 0) {
+				curve_to_jacobian(&pt, jres, prime);
+			} else {
+				// negate last result to make signs of this round and the
+				// last round equal.
+				conditional_negate(sign ^ nsign, &jres->y, prime);
+
+				// add odd factor
+				point_jacobian_add(&pt, jres, curve);
+			}
+			sign = nsign;
+		}
+	}
+	conditional_negate(sign, &jres->y, prime);
+	MEMSET_BZERO(win, sizeof(win));
+	MEMSET_BZERO(&a, sizeof(a));
+	MEMSET_BZERO(&pt, sizeof(pt));
+	return 1;
+}
 
-		// add odd factor
-		point_jacobian_add(&curve->cp[i][lowbits >> 1], &jres, curve);
+// res = k * G
+// k must be a normalized number with 0 <= k < curve->order
+void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *res)
+{
+	jacobian_curve_point jres;
+
+	if (!scalar_multiply_jacobian(curve, k, &jres)) {
+		point_set_infinity(res);
+		return;
 	}
-	conditional_negate(((a.val[0] >> 4) & 1) - 1, &jres.y, prime);
-	jacobian_to_curve(&jres, res, prime);
+	jacobian_to_curve(&jres, res, &curve->prime);
+	MEMSET_BZERO(&jres, sizeof(jres));
 }
 
 #else
 
+static int scalar_multiply_jacobian(const ecdsa_curve *curve, const bignum256 *k, jacobian_curve_point *jres)
+{
+	curve_point p;
+
+	if (bn_is_zero(k)) {
+		return 0;
+	}
+	point_multiply(curve, k, &curve->G, &p);
+	curve_to_jacobian(&p, jres, &curve->prime);
+	MEMSET_BZERO(&p, sizeof(p));
+	return 1;
+}
+
 void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *res)
 {
 	point_multiply(curve, k, &curve->G, res);
@@ -640,6 +1063,195 @@ void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *
 
 #endif
 
+// res[i] = k[i] * G + p[i]  for 0 <= i < n
+// This is the public part of BIP32 child key derivation for several keys.
+// The sums stay in jacobian coordinates and every 4 points share a single
+// inversion instead of two inversions per point.
+// Returns 0 if some k[i] is 0 or some res[i] is the point at infinity,
+// res is undefined in this case.
+int scalar_multiply_add_batch(const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res, int n)
+{
+	int i, j, cnt, ok = 1;
+	jacobian_curve_point jres;
+	bignum256 z[4], tmp[4];
+	const bignum256 *prime = &curve->prime;
+
+	for (i = 0; ok && i < n; i += cnt) {
+		cnt = (n - i < 4) ? n - i : 4;
+		for (j = 0; j < cnt; j++) {
+			if (!scalar_multiply_jacobian(curve, &k[i + j], &jres)) {
+				ok = 0;
+				break;
+			}
+			point_jacobian_add(&p[i + j], &jres, curve);
+			bn_mod(&jres.z, prime);
+			if (bn_is_zero(&jres.z)) {
+				ok = 0;
+				break;
+			}
+			res[i + j].x = jres.x;
+			res[i + j].y = jres.y;
+			z[j] = jres.z;
+		}
+		if (ok) {
+			jacobian_to_curve_batch(res + i, z, tmp, cnt, prime);
+		}
+	}
+	MEMSET_BZERO(&jres, sizeof(jres));
+	MEMSET_BZERO(z, sizeof(z));
+	MEMSET_BZERO(tmp, sizeof(tmp));
+	return ok;
+}
+
+// compute the width-w non-adjacent form of k
+// naf[i] is either 0 or odd with |naf[i]| < 2^(w-1), at most 257 digits
+// returns the number of digits
+// The running time depends on k, use for public data only.
+static int bn_wnaf(const bignum256 *k, int w, int8_t *naf)
+{
+	bignum256 a = *k;
+	int i = 0, d;
+	while (!bn_is_zero(&a)) {
+		d = 0;
+		if (a.val[0] & 1) {
+			d = a.val[0] & ((1 << w) - 1);
+			if (d >= (1 << (w - 1))) {
+				d -= 1 << w;
+				bn_addi(&a, -d);
+			} else {
+				a.val[0] -= d;
+			}
+		}
+		naf[i++] = d;
+		bn_rshift(&a);
+	}
+	return i;
+}
+
+// jp = jp + p, where jp may be the point at infinity (*is_inf set)
+static void point_jacobian_add_public(const curve_point *p, jacobian_curve_point *jp, int *is_inf, const ecdsa_curve *curve)
+{
+	bignum256 z;
+	if (*is_inf) {
+		jp->x = p->x;
+		jp->y = p->y;
+		bn_one(&jp->z);
+		*is_inf = 0;
+		return;
+	}
+	point_jacobian_add(p, jp, curve);
+	// p was the negative of jp
+	z = jp->z;
+	bn_mod(&z, &curve->prime);
+	*is_inf = bn_is_zero(&z);
+}
+
+#if USE_PRECOMPUTED_CP
+// odd multiples of G are taken from the first row of curve->cp
+#define WNAF_G_WIDTH 5
+#else
+#define WNAF_G_WIDTH 4
+#endif
+#define WNAF_P_WIDTH 4
+
+// res = k1 * G + k2 * p
+// All products share a single chain of doublings (Straus-Shamir trick),
+// each scalar is processed in width-w NAF.  If the curve has an
+// endomorphism, k1 and k2 are split into 128 bit halves first, which
+// halves the length of the doubling chain.
+// This is not constant time, use for public data (verification) only.
+void scalar_point_multiply(const ecdsa_curve *curve, const bignum256 *k1, const bignum256 *k2, const curve_point *p, curve_point *res)
+{
+	// room for two full 257 digit or four 129 digit expansions
+	int8_t nafbuf[4 * 129];
+	int8_t *naf[4];
+	int len[4], neg[4] = {0, 0, 0, 0};
+	curve_point pmult[1 << (WNAF_P_WIDTH - 2)];
+#if !USE_PRECOMPUTED_CP
+	curve_point gmult[1 << (WNAF_G_WIDTH - 2)];
+#endif
+	curve_point pt;
+	jacobian_curve_point jres;
+	int n, i, j, d, maxlen = 0, is_inf = 1;
+
+#if USE_ENDOMORPHISM
+	if (curve->endo) {
+		// streams: k1 lo, k1 hi (phi), k2 lo, k2 hi (phi)
+		bignum256 a, b;
+		n = 4;
+		glv_split(curve, k1, &a, &b, &neg[0], &neg[1]);
+		naf[0] = nafbuf;
+		len[0] = bn_wnaf(&a, WNAF_G_WIDTH, naf[0]);
+		naf[1] = nafbuf + 129;
+		len[1] = bn_wnaf(&b, WNAF_G_WIDTH, naf[1]);
+		glv_split(curve, k2, &a, &b, &neg[2], &neg[3]);
+		naf[2] = nafbuf + 2 * 129;
+		len[2] = bn_wnaf(&a, WNAF_P_WIDTH, naf[2]);
+		naf[3] = nafbuf + 3 * 129;
+		len[3] = bn_wnaf(&b, WNAF_P_WIDTH, naf[3]);
+	} else
+#endif
+	{
+		n = 2;
+		naf[0] = nafbuf;
+		len[0] = bn_wnaf(k1, WNAF_G_WIDTH, naf[0]);
+		naf[1] = nafbuf + 257;
+		len[1] = bn_wnaf(k2, WNAF_P_WIDTH, naf[1]);
+	}
+
+	for (j = 0; j < n; j++) {
+		if (len[j] > maxlen) {
+			maxlen = len[j];
+		}
+	}
+	if (len[n / 2] > 0 || len[n - 1] > 0) {
+		point_odd_multiples(curve, p, pmult, 1 << (WNAF_P_WIDTH - 2));
+	}
+#if !USE_PRECOMPUTED_CP
+	if (len[0] > 0 || len[n / 2 - 1] > 0) {
+		point_odd_multiples(curve, &curve->G, gmult, 1 << (WNAF_G_WIDTH - 2));
+	}
+#endif
+
+	for (i = maxlen - 1; i >= 0; i--) {
+		if (!is_inf) {
+			point_jacobian_double(&jres, curve);
+		}
+		for (j = 0; j < n; j++) {
+			d = (i < len[j]) ? naf[j][i] : 0;
+			if (d == 0) {
+				continue;
+			}
+			if (j < n / 2) {
+#if USE_PRECOMPUTED_CP
+				cp_unpack(curve->cp[0][(d < 0 ? -d : d) >> 1].x, &pt.x);
+				cp_unpack(curve->cp[0][(d < 0 ? -d : d) >> 1].y, &pt.y);
+#else
+				pt = gmult[(d < 0 ? -d : d) >> 1];
+#endif
+			} else {
+				pt = pmult[(d < 0 ? -d : d) >> 1];
+			}
+#if USE_ENDOMORPHISM
+			if (n == 4 && (j & 1)) {
+				bn_multiply(&curve->endo->beta, &pt.x, &curve->prime);
+				bn_mod(&pt.x, &curve->prime);
+			}
+#endif
+			if ((d < 0) ^ neg[j]) {
+				bn_subtract(&curve->prime, &pt.y, &pt.y);
+			}
+			point_jacobian_add_public(&pt, &jres, &is_inf, curve);
+		}
+	}
+
+	if (is_inf) {
+		point_set_infinity(res);
+	} else {
+		jacobian_to_curve(&jres, res, &curve->prime);
+	}
+}
+
 int ecdh_multiply(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *pub_key, uint8_t *session_key)
 {
 	curve_point point;
@@ -829,16 +1441,13 @@ int ecdsa_uncompress_pubkey(const ecdsa_curve *curve, const uint8_t *pub_key, ui
 
 void ecdsa_get_pubkeyhash(const uint8_t *pub_key, uint8_t *pubkeyhash)
 {
-	uint8_t h[32];
 	if (pub_key[0] == 0x04) {  // uncompressed format
-		sha256_Raw(pub_key, 65, h);
+		hash160(pub_key, 65, pubkeyhash);
 	} else if (pub_key[0] == 0x00) { // point at infinity
-		sha256_Raw(pub_key, 1, h);
+		hash160(pub_key, 1, pubkeyhash);
 	} else {
-		sha256_Raw(pub_key, 33, h); // expecting compressed format
+		hash160(pub_key, 33, pubkeyhash); // expecting compressed format
 	}
-	ripemd160(h, 32, pubkeyhash);
-	MEMSET_BZERO(h, sizeof(h));
 }
 
 void ecdsa_get_address_raw(const uint8_t *pub_key, uint32_t version, uint8_t *addr_raw)
@@ -865,9 +1474,9 @@ void ecdsa_get_address_segwit_p2sh_raw(const uint8_t *pub_key, uint32_t version,
 	addr_raw[0] = 0; // version byte
 	addr_raw[1] = 20; // push 20 bytes
 	ecdsa_get_pubkeyhash(pub_key, addr_raw + 2);
-	sha256_Raw(addr_raw, 22, digest);
+	hash160(addr_raw, 22, digest);
 	address_write_prefix_bytes(version, addr_raw);
-	ripemd160(digest, 32, addr_raw + prefix_len);
+	memcpy(addr_raw + prefix_len, digest, 20);
 }
 
 void ecdsa_get_address_segwit_p2sh(const uint8_t *pub_key, uint32_t version, char *addr, int addrsize)
@@ -1000,7 +1609,7 @@ int ecdsa_verify_double(const ecdsa_curve *curve, const uint8_t *pub_key, const
 int ecdsa_verify_digest_recover(const ecdsa_curve *curve, uint8_t *pub_key, const uint8_t *sig, const uint8_t *digest, int recid)
 {
 	bignum256 r, s, e;
-	curve_point cp, cp2;
+	curve_point cp;
 
 	// read r and s
 	bn_read_be(sig, &r);
@@ -1031,14 +1640,18 @@ int ecdsa_verify_digest_recover(const ecdsa_curve *curve, uint8_t *pub_key, cons
 	bn_mod(&e, &curve->order);
 	// r := r^-1
 	bn_inverse(&r, &curve->order);
-	// cp := s * R = s * k *G
-	point_multiply(curve, &s, &cp, &cp);
-	// cp2 := -digest * G
-	scalar_multiply(curve, &e, &cp2);
-	// cp := (s * k - digest) * G = (r*priv) * G = r * Pub
-	point_add(curve, &cp2, &cp);
-	// cp := r^{-1} * r * Pub = Pub
-	point_multiply(curve, &r, &cp, &cp);
+	// e := -digest * r^-1
+	bn_multiply(&r, &e, &curve->order);
+	bn_mod(&e, &curve->order);
+	// s := s * r^-1
+	bn_multiply(&r, &s, &curve->order);
+	bn_mod(&s, &curve->order);
+	// cp := r^-1 * (s * R - digest * G) = r^-1 * (s * k - digest) * G
+	//     = r^-1 * (r * priv) * G = Pub
+	scalar_point_multiply(curve, &e, &s, &cp, &cp);
+	if (point_is_infinity(&cp)) {
+		return 1;
+	}
 	pub_key[0] = 0x04;
 	bn_write_be(&cp.x, pub_key + 1);
 	bn_write_be(&cp.y, pub_key + 33);
@@ -1076,13 +1689,14 @@ int ecdsa_verify_digest(const ecdsa_curve *curve, const uint8_t *pub_key, const
 		// I don't expect this to happen any time soon
 		result = 3;
 	} else {
-		scalar_multiply(curve, &z, &res);
+		// res = z*s^-1 * G + r*s^-1 * pub
+		scalar_point_multiply(curve, &z, &s, &pub, &res);
+		if (point_is_infinity(&res)) {
+			result = 4;
+		}
 	}
 
 	if (result == 0) {
-		// both pub and res can be infinity, can have y = 0 OR can be equal -> false negative
-		point_multiply(curve, &s, &pub, &pub);
-		point_add(curve, &pub, &res);
 		bn_mod(&(res.x), &curve->order);
 		// signature does not match
 		if (!bn_is_equal(&res.x, &r)) {
@@ -33,6 +33,25 @@ typedef struct {
 	bignum256 x, y;
 } curve_point;
 
+#if USE_ENDOMORPHISM
+// efficiently computable endomorphism phi(x, y) = (beta*x, y) = lambda*(x, y)
+// and the lattice basis used to split scalars into two 128 bit halves
+typedef struct {
+	bignum256 beta;      // cube root of unity modulo prime
+	bignum256 lambda;    // cube root of unity modulo order
+	bignum256 g1, g2;    // round(2^384 * b2 / order), round(2^384 * -b1 / order)
+	bignum256 minus_b1;  // -b1
+	bignum256 minus_b2;  // -b2 (modulo order)
+} ecdsa_endomorphism;
+#endif
+
+#if USE_PRECOMPUTED_CP
+// precomputed curve point, coordinates packed into 8 little endian words
+typedef struct {
+	uint32_t x[8], y[8];
+} curve_point_packed;
+#endif
+
 typedef struct {
 
 	bignum256 prime;       // prime order of the finite field
@@ -42,8 +61,13 @@ typedef struct {
 	int       a;           // coefficient 'a' of the elliptic curve
 	bignum256 b;           // coefficient 'b' of the elliptic curve
 
+#if USE_ENDOMORPHISM
+	const ecdsa_endomorphism *endo; // GLV endomorphism, NULL if none
+#endif
+
 #if USE_PRECOMPUTED_CP
-	const curve_point cp[64][8];
+	// cp[i][j] = (2*j+1) * 16^(i*PRECOMPUTED_CP_SPACING) * G
+	const curve_point_packed cp[64 / PRECOMPUTED_CP_SPACING][8];
 #endif
 
 } ecdsa_curve;
@@ -57,6 +81,8 @@ int point_is_infinity(const curve_point *p);
 int point_is_equal(const curve_point *p, const curve_point *q);
 int point_is_negative_of(const curve_point *p, const curve_point *q);
 void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *res);
+int scalar_multiply_add_batch(const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res, int n);
+void scalar_point_multiply(const ecdsa_curve *curve, const bignum256 *k1, const bignum256 *k2, const curve_point *p, curve_point *res);
 int ecdh_multiply(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *pub_key, uint8_t *session_key);
 void uncompress_coords(const ecdsa_curve *curve, uint8_t odd, const bignum256 *x, bignum256 *y);
 int ecdsa_uncompress_pubkey(const ecdsa_curve *curve, const uint8_t *pub_key, uint8_t *uncompressed);
@@ -167,3 +167,26 @@ void hmac_sha512_prepare(const uint8_t *key, const uint32_t keylen, uint64_t *op
 	sha512_Transform(sha512_initial_hash_value, o_key_pad, opad_digest);
 	sha512_Transform(sha512_initial_hash_value, i_key_pad, ipad_digest);
 }
+
+// HMAC-SHA512 with the key blocks already compressed by hmac_sha512_prepare,
+// saves the two key block compressions when the key is used repeatedly
+void hmac_sha512_prepared(const uint64_t *opad_digest, const uint64_t *ipad_digest, const uint8_t *msg, const uint32_t msglen, uint8_t *hmac)
+{
+	SHA512_CTX ctx;
+	uint8_t hash[SHA512_DIGEST_LENGTH];
+
+	memcpy(ctx.state, ipad_digest, sizeof(ctx.state));
+	ctx.bitcount[0] = SHA512_BLOCK_LENGTH << 3;
+	ctx.bitcount[1] = 0;
+	sha512_Update(&ctx, msg, msglen);
+	sha512_Final(&ctx, hash);
+
+	memcpy(ctx.state, opad_digest, sizeof(ctx.state));
+	ctx.bitcount[0] = SHA512_BLOCK_LENGTH << 3;
+	ctx.bitcount[1] = 0;
+	sha512_Update(&ctx, hash, SHA512_DIGEST_LENGTH);
+	sha512_Final(&ctx, hmac);
+
+	MEMSET_BZERO(hash, sizeof(hash));
+	MEMSET_BZERO(&ctx, sizeof(ctx));
+}
@@ -48,5 +48,6 @@ void hmac_sha512_Update(HMAC_SHA512_CTX *hctx, const uint8_t *msg, const uint32_
 void hmac_sha512_Final(HMAC_SHA512_CTX *hctx, uint8_t *hmac);
 void hmac_sha512(const uint8_t *key, const uint32_t keylen, const uint8_t *msg, const uint32_t msglen, uint8_t *hmac);
 void hmac_sha512_prepare(const uint8_t *key, const uint32_t keylen, uint64_t *opad_digest, uint64_t *ipad_digest);
+void hmac_sha512_prepared(const uint64_t *opad_digest, const uint64_t *ipad_digest, const uint8_t *msg, const uint32_t msglen, uint8_t *hmac);
 
 #endif
@@ -24,7 +24,62 @@
 #define __OPTIONS_H__
 
 // use precomputed Curve Points (some scalar multiples of curve base point G)
-#define USE_PRECOMPUTED_CP 0
+#ifndef USE_PRECOMPUTED_CP
+#define USE_PRECOMPUTED_CP 1
+#endif
+
+// size/speed tradeoff of the precomputed table: only every n-th row of
+// the full 64x8 table is kept in flash and the missing rows are reached
+// with 4*(n-1) extra point doublings per scalar multiplication.
+// 1 = 32 kB, 2 = 16 kB, 4 = 8 kB, 8 = 4 kB
+#ifndef PRECOMPUTED_CP_SPACING
+#define PRECOMPUTED_CP_SPACING 4
+#endif
+
+// use the secp256k1 endomorphism (GLV) to halve the doubling chain
+// of point multiplications
+#ifndef USE_ENDOMORPHISM
+#define USE_ENDOMORPHISM 1
+#endif
+
+// use a dedicated multiplication and squaring modulo the secp256k1
+// prime 2^256 - 2^32 - 977 in the jacobian point arithmetic
+#ifndef USE_SECP256K1_REDUCTION
+#define USE_SECP256K1_REDUCTION 1
+#endif
+
+// use the Thumb-1 assembler implementation of the limb multiplication
+// (bignum_m0.s), ARM compiler for Cortex-M0 only; off until "make
+// test_bn_asm" has passed under qemu-arm with a cross toolchain
+#ifndef USE_BN_ASM
+#define USE_BN_ASM 0
+#endif
+
+// use the constant time safegcd inverse method, takes precedence
+// over USE_INVERSE_FAST
+#ifndef USE_INVERSE_SAFEGCD
+#define USE_INVERSE_SAFEGCD 1
+#endif
+
+// SHA-256 transform: 0 = rolled loop, 1 = 8 rounds unrolled (small code,
+// for Cortex-M0), 2 = 16 rounds unrolled (for hosts)
+#ifndef USE_SHA256_UNROLL
+#if defined(__x86_64__) || defined(__i386__)
+#define USE_SHA256_UNROLL 2
+#else
+#define USE_SHA256_UNROLL 1
+#endif
+#endif
+
+// compute the SHA-512 transform on 32-bit halves, for targets without
+// 64-bit shifts and rotations (Cortex-M0)
+#ifndef USE_SHA512_32BIT
+#if defined(__x86_64__) || defined(__aarch64__)
+#define USE_SHA512_32BIT 0
+#else
+#define USE_SHA512_32BIT 1
+#endif
+#endif
 
 // use fast inverse method
 #define USE_INVERSE_FAST 1
@@ -37,8 +92,18 @@
 
 // implement BIP32 caching
 #define USE_BIP32_CACHE 1
-#define BIP32_CACHE_SIZE 3
+// number of derived nodes kept, every depth of a path takes one entry:
+// m/44'/0'/0'/0 and m/44'/0'/0'/1 together take five
+#ifndef BIP32_CACHE_SIZE
+#define BIP32_CACHE_SIZE 5
+#endif
 #define BIP32_CACHE_MAXDEPTH 8
+// number of root nodes (seed/curve combinations) the cache keeps apart
+#ifndef BIP32_CACHE_ROOTS
+#define BIP32_CACHE_ROOTS 2
+#endif
+// number of derived public keys kept by the BIP32 cache
+#define BIP32_PUBKEY_CACHE_SIZE 4
 
 // support Ethereum operations
 #define USE_ETHEREUM 0
@@ -26,6 +26,7 @@
  */
 
 #include "ripemd160.h"
+#include "sha2.h"
 #include <string.h>
 
 /*
@@ -68,39 +69,23 @@ void ripemd160_Init(RIPEMD160_CTX *ctx)
 
 #if !defined(MBEDTLS_RIPEMD160_PROCESS_ALT)
 /*
- * Process one block
+ * Compression function on a block of 16 little endian words,
+ * state_out may be the same as state_in
  */
-void ripemd160_process( RIPEMD160_CTX *ctx, const uint8_t data[RIPEMD160_BLOCK_LENGTH] )
+void ripemd160_Transform( const uint32_t state_in[5], const uint32_t X[16], uint32_t state_out[5] )
 {
-    uint32_t A, B, C, D, E, Ap, Bp, Cp, Dp, Ep, X[16];
+    uint32_t A, B, C, D, E, Ap, Bp, Cp, Dp, Ep, T;
 
-    GET_UINT32_LE( X[ 0], data,  0 );
-    GET_UINT32_LE( X[ 1], data,  4 );
-    GET_UINT32_LE( X[ 2], data,  8 );
-    GET_UINT32_LE( X[ 3], data, 12 );
-    GET_UINT32_LE( X[ 4], data, 16 );
-    GET_UINT32_LE( X[ 5], data, 20 );
-    GET_UINT32_LE( X[ 6], data, 24 );
-    GET_UINT32_LE( X[ 7], data, 28 );
-    GET_UINT32_LE( X[ 8], data, 32 );
-    GET_UINT32_LE( X[ 9], data, 36 );
-    GET_UINT32_LE( X[10], data, 40 );
-    GET_UINT32_LE( X[11], data, 44 );
-    GET_UINT32_LE( X[12], data, 48 );
-    GET_UINT32_LE( X[13], data, 52 );
-    GET_UINT32_LE( X[14], data, 56 );
-    GET_UINT32_LE( X[15], data, 60 );
-
-    A = Ap = ctx->state[0];
-    B = Bp = ctx->state[1];
-    C = Cp = ctx->state[2];
-    D = Dp = ctx->state[3];
-    E = Ep = ctx->state[4];
+    A = Ap = state_in[0];
+    B = Bp = state_in[1];
+    C = Cp = state_in[2];
+    D = Dp = state_in[3];
+    E = Ep = state_in[4];
 
 #define F1( x, y, z )   ( x ^ y ^ z )
-#define F2( x, y, z )   ( ( x & y ) | ( ~x & z ) )
+#define F2( x, y, z )   ( z ^ ( x & ( y ^ z ) ) )
 #define F3( x, y, z )   ( ( x | ~y ) ^ z )
-#define F4( x, y, z )   ( ( x & z ) | ( y & ~z ) )
+#define F4( x, y, z )   ( y ^ ( z & ( x ^ y ) ) )
 #define F5( x, y, z )   ( x ^ ( y | ~z ) )
 
 #define S( x, n ) ( ( x << n ) | ( x >> (32 - n) ) )
@@ -239,12 +224,39 @@ void ripemd160_process( RIPEMD160_CTX *ctx, const uint8_t data[RIPEMD160_BLOCK_L
 #undef Fp
 #undef Kp
 
-    C             = ctx->state[1] + C + Dp;
-    ctx->state[1] = ctx->state[2] + D + Ep;
-    ctx->state[2] = ctx->state[3] + E + Ap;
-    ctx->state[3] = ctx->state[4] + A + Bp;
-    ctx->state[4] = ctx->state[0] + B + Cp;
-    ctx->state[0] = C;
+    T            = state_in[1] + C + Dp;
+    state_out[1] = state_in[2] + D + Ep;
+    state_out[2] = state_in[3] + E + Ap;
+    state_out[3] = state_in[4] + A + Bp;
+    state_out[4] = state_in[0] + B + Cp;
+    state_out[0] = T;
+}
+
+/*
+ * Process one block
+ */
+void ripemd160_process( RIPEMD160_CTX *ctx, const uint8_t data[RIPEMD160_BLOCK_LENGTH] )
+{
+    uint32_t X[16];
+
+    GET_UINT32_LE( X[ 0], data,  0 );
+    GET_UINT32_LE( X[ 1], data,  4 );
+    GET_UINT32_LE( X[ 2], data,  8 );
+    GET_UINT32_LE( X[ 3], data, 12 );
+    GET_UINT32_LE( X[ 4], data, 16 );
+    GET_UINT32_LE( X[ 5], data, 20 );
+    GET_UINT32_LE( X[ 6], data, 24 );
+    GET_UINT32_LE( X[ 7], data, 28 );
+    GET_UINT32_LE( X[ 8], data, 32 );
+    GET_UINT32_LE( X[ 9], data, 36 );
+    GET_UINT32_LE( X[10], data, 40 );
+    GET_UINT32_LE( X[11], data, 44 );
+    GET_UINT32_LE( X[12], data, 48 );
+    GET_UINT32_LE( X[13], data, 52 );
+    GET_UINT32_LE( X[14], data, 56 );
+    GET_UINT32_LE( X[15], data, 60 );
+
+    ripemd160_Transform( ctx->state, X, ctx->state );
 }
 #endif /* !MBEDTLS_RIPEMD160_PROCESS_ALT */
 
@@ -337,3 +349,54 @@ void ripemd160(const uint8_t *msg, uint32_t msg_len, uint8_t hash[RIPEMD160_DIGE
     ripemd160_Update( &ctx, msg, msg_len );
     ripemd160_Final( &ctx, hash );
 }
+
+static const uint32_t ripemd160_initial_state[5] =
+{
+    0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+};
+
+/*
+ * output = RIPEMD-160( SHA-256( input buffer ) )
+ *
+ * Inputs of up to 55 bytes (public keys, P2SH-P2WPKH scripts) fit into a
+ * single padded SHA-256 block, and the 32 byte digest always fits into a
+ * single RIPEMD-160 block, so both stages are one compression each on
+ * words built here directly.  Longer inputs take the generic way.
+ */
+void hash160(const uint8_t *msg, uint32_t msg_len, uint8_t hash[RIPEMD160_DIGEST_LENGTH])
+{
+    uint32_t W[16], S[8];
+    uint32_t i;
+
+    if( msg_len > SHA256_BLOCK_LENGTH - 9 )
+    {
+        uint8_t digest[SHA256_DIGEST_LENGTH];
+        sha256_Raw( msg, msg_len, digest );
+        ripemd160( digest, SHA256_DIGEST_LENGTH, hash );
+        memset( digest, 0, sizeof( digest ) );
+        return;
+    }
+
+    /* SHA-256: message, 0x80, zeros, bit length, big endian words */
+    memset( W, 0, sizeof( W ) );
+    for( i = 0; i < msg_len; i++ )
+        W[i >> 2] |= (uint32_t) msg[i] << ( 24 - 8 * ( i & 3 ) );
+    W[i >> 2] |= (uint32_t) 0x80 << ( 24 - 8 * ( i & 3 ) );
+    W[15] = msg_len << 3;
+    sha256_Transform( sha256_initial_hash_value, W, S );
+
+    /* RIPEMD-160: the digest bytes as little endian words, then padding */
+    for( i = 0; i < 8; i++ )
+        W[i] = ( S[i] >> 24 ) | ( ( S[i] >> 8 ) & 0xFF00 )
+             | ( ( S[i] << 8 ) & 0xFF0000 ) | ( S[i] << 24 );
+    W[ 8] = 0x80;
+    W[ 9] = W[10] = W[11] = W[12] = W[13] = W[15] = 0;
+    W[14] = SHA256_DIGEST_LENGTH << 3;
+    ripemd160_Transform( ripemd160_initial_state, W, S );
+
+    for( i = 0; i < 5; i++ )
+        PUT_UINT32_LE( S[i], hash, 4 * i );
+
+    memset( W, 0, sizeof( W ) );
+    memset( S, 0, sizeof( S ) );
+}
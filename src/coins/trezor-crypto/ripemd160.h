@@ -16,5 +16,7 @@ void ripemd160_Init(RIPEMD160_CTX *ctx);
 void ripemd160_Update(RIPEMD160_CTX *ctx, const uint8_t *input, uint32_t ilen);
 void ripemd160_Final(RIPEMD160_CTX *ctx, uint8_t output[RIPEMD160_DIGEST_LENGTH]);
 void ripemd160(const uint8_t *msg, uint32_t msg_len, uint8_t hash[RIPEMD160_DIGEST_LENGTH]);
+void ripemd160_Transform(const uint32_t state_in[5], const uint32_t X[16], uint32_t state_out[5]);
+void hash160(const uint8_t *msg, uint32_t msg_len, uint8_t hash[RIPEMD160_DIGEST_LENGTH]);
 
 #endif
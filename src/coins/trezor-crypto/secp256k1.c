@@ -23,6 +23,34 @@
 
 #include "secp256k1.h"
 
+#if USE_ENDOMORPHISM
+static const ecdsa_endomorphism secp256k1_endo = {
+	/* .beta */ {
+		/*.val =*/ {0x319501ee, 0x4e5b0a1, 0x2f58995c, 0x3c125d44, 0x3434e99c, 0x111e7ab0, 0x7106e6, 0x1a8ad95f, 0x7ae9}
+	},
+
+	/* .lambda */ {
+		/*.val =*/ {0x1b23bd72, 0x3c0a59f0, 0x816678d, 0xb88ba88, 0x12645a12, 0x18700a20, 0x30e0a52, 0x2b533017, 0x5363}
+	},
+
+	/* .g1 */ {
+		/*.val =*/ {0x5dbb031, 0x224c8269, 0x1e8ca7fe, 0x2aa2851c, 0x4eb153d, 0x3243924a, 0x6bcde86, 0x348869f5, 0x3086}
+	},
+
+	/* .g2 */ {
+		/*.val =*/ {0xac47f71, 0x15c6d2ba, 0x1f506c61, 0x4822b27, 0x3fe4c422, 0x11fea42a, 0x288286f5, 0x1fb58043, 0xe443}
+	},
+
+	/* .minus_b1 */ {
+		/*.val =*/ {0xabfe4c3, 0x3d51fea4, 0x10e88286, 0x10dfb580, 0xe4, 0x0, 0x0, 0x0, 0x0}
+	},
+
+	/* .minus_b2 */ {
+		/*.val =*/ {0x3db1562c, 0x1d9736a0, 0x374346dd, 0xa02b141, 0x3ffffe8a, 0x3fffffff, 0x3fffffff, 0x3fffffff, 0xffff}
+	}
+};
+#endif
+
 const ecdsa_curve secp256k1 = {
 	/* .prime */ {
 		/*.val =*/ {0x3ffffc2f, 0x3ffffffb, 0x3fffffff, 0x3fffffff, 0x3fffffff, 0x3fffffff, 0x3fffffff, 0x3fffffff, 0xffff}
@@ -47,6 +75,11 @@ const ecdsa_curve secp256k1 = {
 		/*.val =*/{7}
 	}
 
+#if USE_ENDOMORPHISM
+	,
+	/* endo */ &secp256k1_endo
+#endif
+
 #if USE_PRECOMPUTED_CP
 	,
 	/* cp */ {
@@ -55,8 +88,23 @@ const ecdsa_curve secp256k1 = {
 #endif
 };
 
+// hmac_sha512_prepare of "Bitcoin seed", the opad digest followed by the
+// ipad digest
+static const uint64_t secp256k1_bip32_key_digests[16] = {
+	0xbbd27bac212e9dbdULL, 0xdd0bc55e7e4037c1ULL,
+	0xdfdd3d6890bd6424ULL, 0x2902de663032b34cULL,
+	0xa30f8aa6f67899fcULL, 0x69a566c30f88378fULL,
+	0x0500247985ecb694ULL, 0xf6d70307c6b2d337ULL,
+	0x2e2af459060c1873ULL, 0x7894b868dc88433aULL,
+	0xdd1a797ef1a1933aULL, 0xe6486d04fcb412a7ULL,
+	0xfbcc67b9a396caa0ULL, 0xa2970b146f49b65eULL,
+	0xfdf1daabc66f6248ULL, 0x2ff99c812ada6dc3ULL,
+};
+
 const curve_info secp256k1_info = {
 	/* bip32_name */
 	"Bitcoin seed",
-	&secp256k1
+	&secp256k1,
+	/* bip32_key_digests */
+	secp256k1_bip32_key_digests
 };
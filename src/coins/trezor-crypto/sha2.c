@@ -31,6 +31,7 @@
 #include <string.h>
 #include <stdint.h>
 #include "sha2.h"
+#include "options.h"
 
 /*
  * ASSERT NOTE:
@@ -50,6 +51,9 @@
  *
  *   #define SHA2_UNROLL_TRANSFORM
  *
+ * The SHA-256 transform is selected separately with USE_SHA256_UNROLL,
+ * USE_SHA512_32BIT replaces the SHA-512 transform (see options.h).
+ *
  */
 
 
@@ -697,47 +701,131 @@ void sha256_Init(SHA256_CTX* context) {
 	context->bitcount = 0;
 }
 
-#ifdef SHA2_UNROLL_TRANSFORM
+#if USE_SHA256_UNROLL
 
-/* Unrolled SHA-256 round macros: */
+/*
+ * Unrolled SHA-256 transform.  The working variables are renamed from
+ * round to round instead of being shifted, and the round functions use
+ * at most one temporary each:
+ *
+ *   Ch(e,f,g)  = g ^ (e & (f ^ g))
+ *   Maj(a,b,c) = (a & b) | (c & (a | b))
+ *   Sigma1(e)  = ROTR6(e ^ ROTR5(e ^ ROTR14(e)))
+ *   Sigma0(a)  = ROTR2(a ^ ROTR11(a ^ ROTR9(a)))
+ *
+ * The message schedule word of every round is addressed with constant
+ * offsets: USE_SHA256_UNROLL == 2 unrolls 16 rounds so that all indices
+ * into W256 are constants, USE_SHA256_UNROLL == 1 unrolls 8 rounds and
+ * addresses the two halves of W256 through the pointers w (rounds j..j+7)
+ * and x (the other half), which keeps the code small on Cortex-M0.
+ */
+#define Ch256(x,y,z)	((z) ^ ((x) & ((y) ^ (z))))
+#define Maj256(x,y,z)	(((x) & (y)) | ((z) & ((x) | (y))))
 
-#if BYTE_ORDER == LITTLE_ENDIAN
+/* W[t] += sigma1(W[t-2]) + W[t-7] + sigma0(W[t-15]), indices mod 16 */
+#define SCHEDULE256(w0,w1,w9,w14)	\
+	((w0) += sigma1_256(w14) + (w9) + sigma0_256(w1))
 
-#define ROUND256_0_TO_15(a,b,c,d,e,f,g,h)	\
-	W256[j] = *data++; \
-	T1 = (h) + Sigma1_256(e) + Ch((e), (f), (g)) + \
-             K256[j] + W256[j]; \
+#define ROUND256_W(a,b,c,d,e,f,g,h,k,w)	\
+	T1 = ROTR32(14, (e)) ^ (e); \
+	T1 = ROTR32(5, T1) ^ (e); \
+	T1 = (h) + ROTR32(6, T1) + Ch256((e), (f), (g)) + (k) + (w); \
 	(d) += T1; \
-	(h) = T1 + Sigma0_256(a) + Maj((a), (b), (c)); \
-	j++
+	T2 = ROTR32(9, (a)) ^ (a); \
+	T2 = ROTR32(11, T2) ^ (a); \
+	(h) = T1 + ROTR32(2, T2) + Maj256((a), (b), (c))
 
+#if USE_SHA256_UNROLL == 2
 
-#else /* BYTE_ORDER == LITTLE_ENDIAN */
+#define ROUND256_0_TO_15(a,b,c,d,e,f,g,h,t)	\
+	ROUND256_W(a,b,c,d,e,f,g,h, K256[t], W256[t] = data[t])
 
-#define ROUND256_0_TO_15(a,b,c,d,e,f,g,h)	\
-	T1 = (h) + Sigma1_256(e) + Ch((e), (f), (g)) + \
-	     K256[j] + (W256[j] = *data++); \
-	(d) += T1; \
-	(h) = T1 + Sigma0_256(a) + Maj((a), (b), (c)); \
-	j++
+#define ROUND256(a,b,c,d,e,f,g,h,t)	\
+	ROUND256_W(a,b,c,d,e,f,g,h, K[t], SCHEDULE256(W256[t], \
+		W256[((t)+1)&0x0f], W256[((t)+9)&0x0f], W256[((t)+14)&0x0f]))
 
-#endif /* BYTE_ORDER == LITTLE_ENDIAN */
+void sha256_Transform(const sha2_word32* state_in, const sha2_word32* data, sha2_word32* state_out) {
+	sha2_word32	a, b, c, d, e, f, g, h;
+	sha2_word32	T1, T2, W256[16];
+	const sha2_word32 *K;
+	int		j;
 
-#define ROUND256(a,b,c,d,e,f,g,h)	\
-	s0 = W256[(j+1)&0x0f]; \
-	s0 = sigma0_256(s0); \
-	s1 = W256[(j+14)&0x0f]; \
-	s1 = sigma1_256(s1); \
-	T1 = (h) + Sigma1_256(e) + Ch((e), (f), (g)) + K256[j] + \
-	     (W256[j&0x0f] += s1 + W256[(j+9)&0x0f] + s0); \
-	(d) += T1; \
-	(h) = T1 + Sigma0_256(a) + Maj((a), (b), (c)); \
-	j++
+	/* Initialize registers with the prev. intermediate value */
+	a = state_in[0];
+	b = state_in[1];
+	c = state_in[2];
+	d = state_in[3];
+	e = state_in[4];
+	f = state_in[5];
+	g = state_in[6];
+	h = state_in[7];
+
+	/* Rounds 0 to 15: */
+	ROUND256_0_TO_15(a,b,c,d,e,f,g,h,0);
+	ROUND256_0_TO_15(h,a,b,c,d,e,f,g,1);
+	ROUND256_0_TO_15(g,h,a,b,c,d,e,f,2);
+	ROUND256_0_TO_15(f,g,h,a,b,c,d,e,3);
+	ROUND256_0_TO_15(e,f,g,h,a,b,c,d,4);
+	ROUND256_0_TO_15(d,e,f,g,h,a,b,c,5);
+	ROUND256_0_TO_15(c,d,e,f,g,h,a,b,6);
+	ROUND256_0_TO_15(b,c,d,e,f,g,h,a,7);
+	ROUND256_0_TO_15(a,b,c,d,e,f,g,h,8);
+	ROUND256_0_TO_15(h,a,b,c,d,e,f,g,9);
+	ROUND256_0_TO_15(g,h,a,b,c,d,e,f,10);
+	ROUND256_0_TO_15(f,g,h,a,b,c,d,e,11);
+	ROUND256_0_TO_15(e,f,g,h,a,b,c,d,12);
+	ROUND256_0_TO_15(d,e,f,g,h,a,b,c,13);
+	ROUND256_0_TO_15(c,d,e,f,g,h,a,b,14);
+	ROUND256_0_TO_15(b,c,d,e,f,g,h,a,15);
+
+	/* Now for the remaining rounds to 64: */
+	for (j = 16; j < 64; j += 16) {
+		K = K256 + j;
+		ROUND256(a,b,c,d,e,f,g,h,0);
+		ROUND256(h,a,b,c,d,e,f,g,1);
+		ROUND256(g,h,a,b,c,d,e,f,2);
+		ROUND256(f,g,h,a,b,c,d,e,3);
+		ROUND256(e,f,g,h,a,b,c,d,4);
+		ROUND256(d,e,f,g,h,a,b,c,5);
+		ROUND256(c,d,e,f,g,h,a,b,6);
+		ROUND256(b,c,d,e,f,g,h,a,7);
+		ROUND256(a,b,c,d,e,f,g,h,8);
+		ROUND256(h,a,b,c,d,e,f,g,9);
+		ROUND256(g,h,a,b,c,d,e,f,10);
+		ROUND256(f,g,h,a,b,c,d,e,11);
+		ROUND256(e,f,g,h,a,b,c,d,12);
+		ROUND256(d,e,f,g,h,a,b,c,13);
+		ROUND256(c,d,e,f,g,h,a,b,14);
+		ROUND256(b,c,d,e,f,g,h,a,15);
+	}
+
+	/* Compute the current intermediate hash value */
+	state_out[0] = state_in[0] + a;
+	state_out[1] = state_in[1] + b;
+	state_out[2] = state_in[2] + c;
+	state_out[3] = state_in[3] + d;
+	state_out[4] = state_in[4] + e;
+	state_out[5] = state_in[5] + f;
+	state_out[6] = state_in[6] + g;
+	state_out[7] = state_in[7] + h;
+
+	/* Clean up */
+	a = b = c = d = e = f = g = h = T1 = T2 = 0;
+}
+
+#else /* USE_SHA256_UNROLL == 2 */
+
+#define ROUND256_0_TO_15(a,b,c,d,e,f,g,h,t)	\
+	ROUND256_W(a,b,c,d,e,f,g,h, K[t], w[t] = data[t])
+
+#define ROUND256(a,b,c,d,e,f,g,h,t,w0,w1,w9,w14)	\
+	ROUND256_W(a,b,c,d,e,f,g,h, K[t], SCHEDULE256(w0, w1, w9, w14))
 
 void sha256_Transform(const sha2_word32* state_in, const sha2_word32* data, sha2_word32* state_out) {
-	sha2_word32	a, b, c, d, e, f, g, h, s0, s1;
-	sha2_word32	T1;
-	sha2_word32 W256[16];
+	sha2_word32	a, b, c, d, e, f, g, h;
+	sha2_word32	T1, T2, W256[16];
+	sha2_word32	*w, *x;
+	const sha2_word32 *K;
 	int		j;
 
 	/* Initialize registers with the prev. intermediate value */
@@ -750,30 +838,35 @@ void sha256_Transform(const sha2_word32* state_in, const sha2_word32* data, sha2
 	g = state_in[6];
 	h = state_in[7];
 
-	j = 0;
-	do {
+	for (j = 0; j < 16; j += 8) {
 		/* Rounds 0 to 15 (unrolled): */
-		ROUND256_0_TO_15(a,b,c,d,e,f,g,h);
-		ROUND256_0_TO_15(h,a,b,c,d,e,f,g);
-		ROUND256_0_TO_15(g,h,a,b,c,d,e,f);
-		ROUND256_0_TO_15(f,g,h,a,b,c,d,e);
-		ROUND256_0_TO_15(e,f,g,h,a,b,c,d);
-		ROUND256_0_TO_15(d,e,f,g,h,a,b,c);
-		ROUND256_0_TO_15(c,d,e,f,g,h,a,b);
-		ROUND256_0_TO_15(b,c,d,e,f,g,h,a);
-	} while (j < 16);
+		K = K256 + j;
+		w = W256 + j;
+		ROUND256_0_TO_15(a,b,c,d,e,f,g,h,0);
+		ROUND256_0_TO_15(h,a,b,c,d,e,f,g,1);
+		ROUND256_0_TO_15(g,h,a,b,c,d,e,f,2);
+		ROUND256_0_TO_15(f,g,h,a,b,c,d,e,3);
+		ROUND256_0_TO_15(e,f,g,h,a,b,c,d,4);
+		ROUND256_0_TO_15(d,e,f,g,h,a,b,c,5);
+		ROUND256_0_TO_15(c,d,e,f,g,h,a,b,6);
+		ROUND256_0_TO_15(b,c,d,e,f,g,h,a,7);
+		data += 8;
+	}
 
 	/* Now for the remaining rounds to 64: */
-	do {
-		ROUND256(a,b,c,d,e,f,g,h);
-		ROUND256(h,a,b,c,d,e,f,g);
-		ROUND256(g,h,a,b,c,d,e,f);
-		ROUND256(f,g,h,a,b,c,d,e);
-		ROUND256(e,f,g,h,a,b,c,d);
-		ROUND256(d,e,f,g,h,a,b,c);
-		ROUND256(c,d,e,f,g,h,a,b);
-		ROUND256(b,c,d,e,f,g,h,a);
-	} while (j < 64);
+	for (; j < 64; j += 8) {
+		K = K256 + j;
+		w = W256 + (j & 8);
+		x = W256 + (~j & 8);
+		ROUND256(a,b,c,d,e,f,g,h,0, w[0], w[1], x[1], x[6]);
+		ROUND256(h,a,b,c,d,e,f,g,1, w[1], w[2], x[2], x[7]);
+		ROUND256(g,h,a,b,c,d,e,f,2, w[2], w[3], x[3], w[0]);
+		ROUND256(f,g,h,a,b,c,d,e,3, w[3], w[4], x[4], w[1]);
+		ROUND256(e,f,g,h,a,b,c,d,4, w[4], w[5], x[5], w[2]);
+		ROUND256(d,e,f,g,h,a,b,c,5, w[5], w[6], x[6], w[3]);
+		ROUND256(c,d,e,f,g,h,a,b,6, w[6], w[7], x[7], w[4]);
+		ROUND256(b,c,d,e,f,g,h,a,7, w[7], x[0], w[0], w[5]);
+	}
 
 	/* Compute the current intermediate hash value */
 	state_out[0] = state_in[0] + a;
@@ -786,10 +879,12 @@ void sha256_Transform(const sha2_word32* state_in, const sha2_word32* data, sha2
 	state_out[7] = state_in[7] + h;
 
 	/* Clean up */
-	a = b = c = d = e = f = g = h = T1 = 0;
+	a = b = c = d = e = f = g = h = T1 = T2 = 0;
 }
 
-#else /* SHA2_UNROLL_TRANSFORM */
+#endif /* USE_SHA256_UNROLL == 2 */
+
+#else /* USE_SHA256_UNROLL */
 
 void sha256_Transform(const sha2_word32* state_in, const sha2_word32* data, sha2_word32* state_out) {
 	sha2_word32	a, b, c, d, e, f, g, h, s0, s1;
@@ -860,7 +955,7 @@ void sha256_Transform(const sha2_word32* state_in, const sha2_word32* data, sha2
 	a = b = c = d = e = f = g = h = T1 = T2 = 0;
 }
 
-#endif /* SHA2_UNROLL_TRANSFORM */
+#endif /* USE_SHA256_UNROLL */
 
 void sha256_Update(SHA256_CTX* context, const sha2_byte *data, size_t len) {
 	unsigned int	freespace, usedspace;
@@ -1020,7 +1115,111 @@ void sha512_Init(SHA512_CTX* context) {
 	context->bitcount[0] = context->bitcount[1] =  0;
 }
 
-#ifdef SHA2_UNROLL_TRANSFORM
+#if USE_SHA512_32BIT
+
+/*
+ * SHA-512 transform on 32-bit halves for targets without a 64-bit ALU,
+ * where every 64-bit rotation turns into shifts and merges of a register
+ * pair and the eight shifted working variables do not fit in registers.
+ * A 64-bit word x is kept as the pair xh:xl, the rotations below are the
+ * ones of the SHA-512 functions written out on the two halves.  The
+ * working variables a..h live in sh/sl and are addressed relative to the
+ * round (a is at index -j & 7), so a round only writes the two words that
+ * change and the loop body stays small.
+ */
+#define Sigma0_512h(h,l)	(((h) >> 28 | (l) <<  4) ^ ((l) >>  2 | (h) << 30) ^ ((l) >>  7 | (h) << 25))
+#define Sigma0_512l(h,l)	(((l) >> 28 | (h) <<  4) ^ ((h) >>  2 | (l) << 30) ^ ((h) >>  7 | (l) << 25))
+#define Sigma1_512h(h,l)	(((h) >> 14 | (l) << 18) ^ ((h) >> 18 | (l) << 14) ^ ((l) >>  9 | (h) << 23))
+#define Sigma1_512l(h,l)	(((l) >> 14 | (h) << 18) ^ ((l) >> 18 | (h) << 14) ^ ((h) >>  9 | (l) << 23))
+#define sigma0_512h(h,l)	(((h) >>  1 | (l) << 31) ^ ((h) >>  8 | (l) << 24) ^ ((h) >> 7))
+#define sigma0_512l(h,l)	(((l) >>  1 | (h) << 31) ^ ((l) >>  8 | (h) << 24) ^ ((l) >> 7 | (h) << 25))
+#define sigma1_512h(h,l)	(((h) >> 19 | (l) << 13) ^ ((h) <<  3 | (l) >> 29) ^ ((h) >> 6))
+#define sigma1_512l(h,l)	(((l) >> 19 | (h) << 13) ^ ((l) <<  3 | (h) >> 29) ^ ((l) >> 6 | (h) << 26))
+
+/* xh:xl += yh:yl */
+#define ADD512(xh,xl,yh,yl)	{ \
+	(xl) += (yl); \
+	(xh) += (yh) + ((xl) < (yl)); \
+}
+
+void sha512_Transform(const sha2_word64* state_in, const sha2_word64* data, sha2_word64* state_out) {
+	sha2_word32	sh[8], sl[8], wh[16], wl[16];
+	sha2_word32	t1h, t1l, t2h, t2l, xh, xl, yh, yl;
+	int		j, a, d, e, h;
+
+	/* Initialize registers with the prev. intermediate value */
+	for (j = 0; j < 8; j++) {
+		sh[j] = (sha2_word32)(state_in[j] >> 32);
+		sl[j] = (sha2_word32)state_in[j];
+	}
+
+	for (j = 0; j < 80; j++) {
+		/* Part of the message block expansion: */
+		if (j < 16) {
+			wh[j] = (sha2_word32)(data[j] >> 32);
+			wl[j] = (sha2_word32)data[j];
+		} else {
+			xh = wh[(j+14)&0x0f];
+			xl = wl[(j+14)&0x0f];
+			t1h = sigma1_512h(xh, xl);
+			t1l = sigma1_512l(xh, xl);
+			xh = wh[(j+1)&0x0f];
+			xl = wl[(j+1)&0x0f];
+			t2h = sigma0_512h(xh, xl);
+			t2l = sigma0_512l(xh, xl);
+			ADD512(t1h, t1l, t2h, t2l);
+			ADD512(t1h, t1l, wh[(j+9)&0x0f], wl[(j+9)&0x0f]);
+			ADD512(wh[j&0x0f], wl[j&0x0f], t1h, t1l);
+		}
+
+		a = -j & 7;
+		d = (a + 3) & 7;
+		e = (a + 4) & 7;
+		h = (a + 7) & 7;
+
+		/* T1 = h + Sigma1(e) + Ch(e, f, g) + K512[j] + W512[j] */
+		xh = sh[e];
+		xl = sl[e];
+		t1h = Sigma1_512h(xh, xl);
+		t1l = Sigma1_512l(xh, xl);
+		yh = sh[(e+2)&7];
+		yl = sl[(e+2)&7];
+		t2h = yh ^ (xh & (sh[(e+1)&7] ^ yh));
+		t2l = yl ^ (xl & (sl[(e+1)&7] ^ yl));
+		ADD512(t1h, t1l, t2h, t2l);
+		ADD512(t1h, t1l, sh[h], sl[h]);
+		ADD512(t1h, t1l, (sha2_word32)(K512[j] >> 32), (sha2_word32)K512[j]);
+		ADD512(t1h, t1l, wh[j&0x0f], wl[j&0x0f]);
+
+		/* T2 = Sigma0(a) + Maj(a, b, c) */
+		xh = sh[a];
+		xl = sl[a];
+		t2h = Sigma0_512h(xh, xl);
+		t2l = Sigma0_512l(xh, xl);
+		yh = sh[(a+1)&7];
+		yl = sl[(a+1)&7];
+		ADD512(t2h, t2l, (xh & yh) | (sh[(a+2)&7] & (xh | yh)),
+		                 (xl & yl) | (sl[(a+2)&7] & (xl | yl)));
+
+		/* d += T1, the new a is T1 + T2 and takes the place of h */
+		ADD512(sh[d], sl[d], t1h, t1l);
+		ADD512(t1h, t1l, t2h, t2l);
+		sh[h] = t1h;
+		sl[h] = t1l;
+	}
+
+	/* Compute the current intermediate hash value */
+	for (j = 0; j < 8; j++) {
+		state_out[j] = state_in[j] + (((sha2_word64)sh[j] << 32) | sl[j]);
+	}
+
+	/* Clean up */
+	MEMSET_BZERO(sh, sizeof(sh));
+	MEMSET_BZERO(sl, sizeof(sl));
+	t1h = t1l = t2h = t2l = xh = xl = yh = yl = 0;
+}
+
+#elif defined(SHA2_UNROLL_TRANSFORM)
 
 /* Unrolled SHA-512 round macros: */
 #define ROUND512_0_TO_15(a,b,c,d,e,f,g,h)	\
@@ -1165,7 +1364,7 @@ void sha512_Transform(const sha2_word64* state_in, const sha2_word64* data, sha2
 	a = b = c = d = e = f = g = h = T1 = T2 = 0;
 }
 
-#endif /* SHA2_UNROLL_TRANSFORM */
+#endif /* USE_SHA512_32BIT */
 
 void sha512_Update(SHA512_CTX* context, const sha2_byte *data, size_t len) {
 	unsigned int	freespace, usedspace;
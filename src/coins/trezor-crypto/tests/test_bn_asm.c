@@ -0,0 +1,131 @@
+/**
+ * Equivalence test for the Cortex-M0 bignum core (bignum_m0.s)
+ *
+ * Runs bn_multiply_long, bn_square_long and bn_multiply_reduce_step from
+ * bignum.c (built with USE_BN_ASM=0) and their _m0 assembler versions on
+ * the same edge and pseudo-random inputs and compares every limb. The
+ * reduction is checked step by step for both the secp256k1 prime and the
+ * group order. Build and run under qemu with "make test_bn_asm", see the
+ * Makefile in this directory.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "bignum.h"
+#include "secp256k1.h"
+
+#define TEST_RANDOM 2000
+
+void bn_multiply_reduce_step(uint32_t res[18], const bignum256 *prime, uint32_t i);
+
+void bn_multiply_long_m0(const bignum256 *k, const bignum256 *x, uint32_t res[18]);
+void bn_square_long_m0(const bignum256 *x, uint32_t res[18]);
+void bn_multiply_reduce_step_m0(uint32_t res[18], const bignum256 *prime, uint32_t i);
+
+static uint32_t seed = 0x2545f491;
+static int failed = 0;
+
+static uint32_t rnd32(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+// normalized limbs; top limb up to 30 bits unless below_2_256 is set
+static void rnd_bn(bignum256 *a, int below_2_256)
+{
+	int i;
+	for (i = 0; i < 9; i++) {
+		a->val[i] = rnd32() & 0x3FFFFFFF;
+	}
+	// sparse values exercise the carry paths differently
+	if (rnd32() & 1) {
+		for (i = 0; i < 9; i++) {
+			if (rnd32() & 1) a->val[i] = (rnd32() & 1) ? 0x3FFFFFFF : 0;
+		}
+	}
+	if (below_2_256) a->val[8] &= 0xFFFF;
+}
+
+static void check(const char *what, const uint32_t *c, const uint32_t *m0, int n)
+{
+	if (memcmp(c, m0, n * sizeof(uint32_t)) == 0) return;
+	if (failed++ < 10) printf("FAIL %s\n", what);
+}
+
+static void test_multiply(const bignum256 *a, const bignum256 *b)
+{
+	uint32_t res_c[18], res_m0[18];
+	memset(res_c, 0xAA, sizeof(res_c));
+	memset(res_m0, 0x55, sizeof(res_m0));
+	bn_multiply_long(a, b, res_c);
+	bn_multiply_long_m0(a, b, res_m0);
+	check("bn_multiply_long", res_c, res_m0, 18);
+#if USE_SECP256K1_REDUCTION
+	memset(res_c, 0xAA, sizeof(res_c));
+	memset(res_m0, 0x55, sizeof(res_m0));
+	bn_square_long(a, res_c);
+	bn_square_long_m0(a, res_m0);
+	check("bn_square_long", res_c, res_m0, 18);
+#endif
+}
+
+// a, b < 2^256, so a * b < 2^270 * 2 * prime as bn_multiply_reduce expects
+static void test_reduce(const bignum256 *a, const bignum256 *b, const bignum256 *prime)
+{
+	uint32_t res_c[18], res_m0[18];
+	int i;
+	bn_multiply_long(a, b, res_c);
+	memcpy(res_m0, res_c, sizeof(res_c));
+	for (i = 16; i >= 8; i--) {
+		bn_multiply_reduce_step(res_c, prime, i);
+		bn_multiply_reduce_step_m0(res_m0, prime, i);
+		check("bn_multiply_reduce_step", res_c, res_m0, 18);
+	}
+}
+
+int main(void)
+{
+	const bignum256 *primes[2] = { &secp256k1.prime, &secp256k1.order };
+	bignum256 edge[10], a, b;
+	int nedge = 0, i, j, k;
+
+	// 0, 1, 2^256 - 1, 2^270 - 1, p - 1, p, n - 1, n, 2^255, 2^30
+	memset(edge, 0, sizeof(edge));
+	nedge++;
+	edge[nedge++].val[0] = 1;
+	for (i = 0; i < 9; i++) edge[nedge].val[i] = 0x3FFFFFFF;
+	edge[nedge++].val[8] = 0xFFFF;
+	for (i = 0; i < 9; i++) edge[nedge].val[i] = 0x3FFFFFFF;
+	nedge++;
+	for (k = 0; k < 2; k++) {
+		edge[nedge] = *primes[k];
+		edge[nedge++].val[0]--;
+		edge[nedge++] = *primes[k];
+	}
+	edge[nedge++].val[8] = 0x8000;
+	edge[nedge++].val[1] = 1;
+
+	for (i = 0; i < nedge; i++) {
+		for (j = 0; j < nedge; j++) {
+			test_multiply(&edge[i], &edge[j]);
+			if (edge[i].val[8] <= 0xFFFF && edge[j].val[8] <= 0xFFFF) {
+				for (k = 0; k < 2; k++) test_reduce(&edge[i], &edge[j], primes[k]);
+			}
+		}
+	}
+	for (i = 0; i < TEST_RANDOM; i++) {
+		rnd_bn(&a, 0);
+		rnd_bn(&b, 0);
+		test_multiply(&a, &b);
+		rnd_bn(&a, 1);
+		rnd_bn(&b, 1);
+		test_reduce(&a, &b, primes[i & 1]);
+	}
+
+	printf("%s: %d edge, %d random vectors, %d failures\n",
+		failed ? "FAIL" : "OK", nedge * nedge, TEST_RANDOM, failed);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,214 @@
+/**
+ * Host benchmark of the trezor-crypto primitives
+ *
+ * Host counterpart of the "bench" console command (src/bench.c), built
+ * against the library sources only, see the Makefile in this directory:
+ *
+ *   make bench
+ *   ./tools/bench_host [name-prefix]
+ *
+ * Every primitive is repeated, doubling the iteration count, until one run
+ * takes at least BENCH_MIN_NS. The result is one JSON object with an entry
+ * per primitive. cycles_per_op comes from the time stamp counter on x86
+ * and is null elsewhere.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#else
+#define BENCH_HAVE_TSC 0
+#endif
+
+#include "bignum.h"
+#include "ecdsa.h"
+#include "secp256k1.h"
+#include "bip32.h"
+#include "curves.h"
+#include "sha2.h"
+#include "hmac.h"
+#include "base58.h"
+
+#define BENCH_MIN_NS    200000000ULL
+
+typedef void (*bench_proc)(void);
+
+struct bench_entry {
+	const char *name;
+	bench_proc proc;
+};
+
+static const uint8_t bench_privkey[32] = {
+	0xcc, 0xa9, 0xfb, 0xcc, 0x1b, 0x41, 0xe5, 0xa9, 0x5d, 0x36, 0x9e, 0xaa, 0x6d, 0xdc, 0xff, 0x73,
+	0xb6, 0x1a, 0x4e, 0xfa, 0xa2, 0x79, 0xcf, 0xc6, 0x56, 0x7e, 0x8d, 0xaa, 0x39, 0xcb, 0xaf, 0x50
+};
+
+static uint8_t bench_digest[32];
+static uint8_t bench_pubkey[65];
+static uint8_t bench_sig[64];
+static uint8_t bench_recid;
+static uint8_t bench_out[65];
+static char bench_str[MAX_ADDR_SIZE];
+static curve_point bench_point, bench_res;
+static bignum256 bench_k, bench_inv;
+static HDNode bench_node;
+
+static void bench_ecdsa_sign_digest(void)
+{
+	ecdsa_sign_digest(&secp256k1, bench_privkey, bench_digest, bench_out, NULL, NULL);
+}
+
+static void bench_ecdsa_verify_digest(void)
+{
+	ecdsa_verify_digest(&secp256k1, bench_pubkey, bench_sig, bench_digest);
+}
+
+static void bench_ecdsa_verify_digest_recover(void)
+{
+	ecdsa_verify_digest_recover(&secp256k1, bench_out, bench_sig, bench_digest, bench_recid);
+}
+
+static void bench_ecdsa_get_public_key33(void)
+{
+	ecdsa_get_public_key33(&secp256k1, bench_privkey, bench_out);
+}
+
+static void bench_point_multiply(void)
+{
+	point_multiply(&secp256k1, &bench_k, &bench_point, &bench_res);
+}
+
+static void bench_scalar_multiply(void)
+{
+	scalar_multiply(&secp256k1, &bench_k, &bench_res);
+}
+
+static void bench_bn_inverse(void)
+{
+	bench_inv = bench_k;
+	bn_inverse(&bench_inv, &secp256k1.prime);
+}
+
+static void bench_hdnode_private_ckd(void)
+{
+	hdnode_private_ckd(&bench_node, 0);
+	bench_node.depth = 0;
+}
+
+static void bench_hdnode_fill_public_key(void)
+{
+	bench_node.public_key[0] = 0;
+	hdnode_fill_public_key(&bench_node);
+}
+
+static void bench_sha256_raw(void)
+{
+	sha256_Raw(bench_pubkey, sizeof(bench_pubkey), bench_out);
+}
+
+static void bench_sha512_raw(void)
+{
+	sha512_Raw(bench_pubkey, sizeof(bench_pubkey), bench_out);
+}
+
+static void bench_ecdsa_get_pubkeyhash(void)
+{
+	ecdsa_get_pubkeyhash(bench_pubkey, bench_out);
+}
+
+static void bench_hmac_sha256(void)
+{
+	hmac_sha256(bench_node.chain_code, 32, bench_pubkey, 37, bench_out);
+}
+
+static void bench_hmac_sha512(void)
+{
+	hmac_sha512(bench_node.chain_code, 32, bench_pubkey, 37, bench_out);
+}
+
+static void bench_base58_encode_check(void)
+{
+	base58_encode_check(bench_pubkey, 21, bench_str, sizeof(bench_str));
+}
+
+static const struct bench_entry bench_list[] = {
+	{ "ecdsa_sign_digest",           bench_ecdsa_sign_digest },
+	{ "ecdsa_verify_digest",         bench_ecdsa_verify_digest },
+	{ "ecdsa_verify_digest_recover", bench_ecdsa_verify_digest_recover },
+	{ "ecdsa_get_public_key33",      bench_ecdsa_get_public_key33 },
+	{ "point_multiply",              bench_point_multiply },
+	{ "scalar_multiply",             bench_scalar_multiply },
+	{ "bn_inverse",                  bench_bn_inverse },
+	{ "hdnode_private_ckd",          bench_hdnode_private_ckd },
+	{ "hdnode_fill_public_key",      bench_hdnode_fill_public_key },
+	{ "sha256_Raw",                  bench_sha256_raw },
+	{ "sha512_Raw",                  bench_sha512_raw },
+	{ "ecdsa_get_pubkeyhash",        bench_ecdsa_get_pubkeyhash },
+	{ "hmac_sha256",                 bench_hmac_sha256 },
+	{ "hmac_sha512",                 bench_hmac_sha512 },
+	{ "base58_encode_check",         bench_base58_encode_check },
+};
+
+static void bench_setup(void)
+{
+	sha256_Raw((const uint8_t *)"Hideez", 6, bench_digest);
+	ecdsa_get_public_key33(&secp256k1, bench_privkey, bench_pubkey);
+	ecdsa_sign_digest(&secp256k1, bench_privkey, bench_digest, bench_sig, &bench_recid, NULL);
+	bn_read_be(bench_digest, &bench_k);
+	point_copy(&secp256k1.G, &bench_point);
+	hdnode_from_xprv(0, 0, bench_digest, bench_privkey, SECP256K1_NAME, &bench_node);
+}
+
+static uint64_t bench_ns(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+static uint64_t bench_cycles(void)
+{
+#if BENCH_HAVE_TSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+int main(int argc, char **argv)
+{
+	const char *filter = (argc > 1) ? argv[1] : "";
+	const struct bench_entry *b;
+	uint64_t t0, c0, ns, cycles, iters, i;
+	int n = 0;
+
+	bench_setup();
+	printf("{\"host\":true,\"bench\":[");
+	for (b = bench_list; b < bench_list + sizeof(bench_list)/sizeof(bench_list[0]); b++) {
+		if (strncmp(filter, b->name, strlen(filter)) != 0) continue;
+		for (iters = 1; ; iters <<= 1) {
+			t0 = bench_ns();
+			c0 = bench_cycles();
+			for (i = 0; i < iters; i++) {
+				b->proc();
+			}
+			cycles = bench_cycles() - c0;
+			ns = bench_ns() - t0;
+			if (ns >= BENCH_MIN_NS) break;
+		}
+		printf("%s\n{\"name\":\"%s\",\"iters\":%llu,\"us_per_op\":%.3f,", n++ ? "," : "",
+			b->name, (unsigned long long)iters, ns / 1000.0 / iters);
+		if (BENCH_HAVE_TSC) {
+			printf("\"cycles_per_op\":%.0f,", (double)cycles / iters);
+		} else {
+			printf("\"cycles_per_op\":null,");
+		}
+		printf("\"ops_per_sec\":%.1f}", iters * 1e9 / ns);
+	}
+	printf("\n]}\n");
+	return 0;
+}
@@ -0,0 +1,11 @@
+#ifndef _CONSOLE_H_
+#define _CONSOLE_H_
+
+// host stand-in for src/console.h, debug output goes to stdout
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#define dprintf printf
+
+#endif
@@ -0,0 +1,26 @@
+/*
+ *  Host stand-in for the nRF51 RNG driver.
+ *
+ *  xorshift32 with a fixed seed, so benchmark and test runs repeat exactly.
+ *  Not suitable for generating keys.
+ */
+
+#include "random.h"
+
+static uint32_t state = 0x2545f491;
+
+uint32_t random32(void)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+void get_random_bytes(void *data, int len)
+{
+	uint8_t *p = (uint8_t *)data;
+	while (len--) {
+		*p++ = (uint8_t)random32();
+	}
+}
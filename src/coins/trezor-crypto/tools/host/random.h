@@ -0,0 +1,11 @@
+#ifndef _RANDOM_H_
+#define _RANDOM_H_
+
+// host stand-in for src/random.h, see random.c
+
+#include <stdint.h>
+
+void get_random_bytes(void *data, int len);
+uint32_t random32(void);
+
+#endif
@@ -0,0 +1,122 @@
+/**
+ * Generator for the precomputed curve point table (secp256k1.table)
+ *
+ * Build and run on the host from the trezor-crypto directory:
+ *
+ *   cc -DUSE_PRECOMPUTED_CP=0 -I. -o mktable tools/mktable.c bignum.c secp256k1.c
+ *   ./mktable > secp256k1.table
+ *
+ * The full table cp[i][j] = (2*j+1) * 16^i * G (64x8 points) is written,
+ * every row wrapped in a preprocessor condition, so the table size is
+ * selected by PRECOMPUTED_CP_SPACING in options.h without regenerating it.
+ */
+
+#include <stdio.h>
+#include "bignum.h"
+#include "ecdsa.h"
+#include "secp256k1.h"
+
+// cp2 = cp1 + cp2, points are distinct and not infinity
+static void add(const bignum256 *prime, const curve_point *cp1, curve_point *cp2)
+{
+	bignum256 lambda, inv, xr, yr;
+
+	bn_subtractmod(&(cp2->x), &(cp1->x), &inv, prime);
+	bn_inverse(&inv, prime);
+	bn_subtractmod(&(cp2->y), &(cp1->y), &lambda, prime);
+	bn_multiply(&inv, &lambda, prime);
+
+	xr = lambda;
+	bn_multiply(&xr, &xr, prime);
+	yr = cp1->x;
+	bn_addmod(&yr, &(cp2->x), prime);
+	bn_subtractmod(&xr, &yr, &xr, prime);
+	bn_fast_mod(&xr, prime);
+	bn_mod(&xr, prime);
+
+	bn_subtractmod(&(cp2->x), &xr, &yr, prime);
+	bn_multiply(&lambda, &yr, prime);
+	bn_subtractmod(&yr, &(cp2->y), &yr, prime);
+	bn_fast_mod(&yr, prime);
+	bn_mod(&yr, prime);
+
+	cp2->x = xr;
+	cp2->y = yr;
+}
+
+// cp = 2 * cp for a curve with a = 0
+static void dbl(const bignum256 *prime, curve_point *cp)
+{
+	bignum256 lambda, xr, yr;
+
+	// lambda = 3 x^2 / 2y
+	lambda = cp->y;
+	bn_mult_k(&lambda, 2, prime);
+	bn_inverse(&lambda, prime);
+	xr = cp->x;
+	bn_multiply(&xr, &xr, prime);
+	bn_mult_k(&xr, 3, prime);
+	bn_multiply(&xr, &lambda, prime);
+
+	xr = lambda;
+	bn_multiply(&xr, &xr, prime);
+	yr = cp->x;
+	bn_lshift(&yr);
+	bn_mod(&yr, prime);
+	bn_subtractmod(&xr, &yr, &xr, prime);
+	bn_fast_mod(&xr, prime);
+	bn_mod(&xr, prime);
+
+	bn_subtractmod(&(cp->x), &xr, &yr, prime);
+	bn_multiply(&lambda, &yr, prime);
+	bn_subtractmod(&yr, &(cp->y), &yr, prime);
+	bn_fast_mod(&yr, prime);
+	bn_mod(&yr, prime);
+
+	cp->x = xr;
+	cp->y = yr;
+}
+
+static void print_coord(const bignum256 *a)
+{
+	uint8_t le[32];
+	int i;
+	bn_write_le(a, le);
+	printf("{");
+	for (i = 0; i < 8; i++) {
+		printf("0x%08x%s", read_le(le + 4 * i), i < 7 ? ", " : "");
+	}
+	printf("}");
+}
+
+int main(void)
+{
+	const ecdsa_curve *curve = &secp256k1;
+	curve_point base, twice, p;
+	int i, j;
+
+	printf("// generated by tools/mktable.c, do not edit\n");
+	printf("// cp[i][j] = (2*j+1) * 16^(i*PRECOMPUTED_CP_SPACING) * G\n");
+	base = curve->G;
+	for (i = 0; i < 64; i++) {
+		printf("#if (%d %% PRECOMPUTED_CP_SPACING) == 0\n", i);
+		printf("\t{\n");
+		twice = base;
+		dbl(&curve->prime, &twice);
+		p = base;
+		for (j = 0; j < 8; j++) {
+			printf("\t\t/* %2d*16^%d*G */ {", 2 * j + 1, i);
+			print_coord(&p.x);
+			printf(", ");
+			print_coord(&p.y);
+			printf("},\n");
+			add(&curve->prime, &twice, &p);
+		}
+		printf("\t},\n");
+		printf("#endif\n");
+		for (j = 0; j < 4; j++) {
+			dbl(&curve->prime, &base);
+		}
+	}
+	return 0;
+}
@@ -1,4 +1,5 @@
 #include "main.h"
+#include "bip32.h"
 
 #if (CONSOLE!=0)
 
@@ -66,6 +67,25 @@ void console_tx(char c)
 	}
 }
 
+void console_direct(bool on)
+{
+	// synchronous output, for long reports printed from interrupt context
+	// (drain the buffer by polling, TXDRDY interrupt may be masked here)
+	while (state & STATE_SENDING) {
+		if (! NRF_UART0->EVENTS_TXDRDY) continue;
+		NRF_UART0->EVENTS_TXDRDY = 0;
+		if (txtail != txhead) {
+			NRF_UART0->TXD = uart_tx_buffer[txtail];
+			txtail = (txtail + 1) % CONSOLE_TX_BUFFER_SIZE;
+		} else {
+			NRF_UART0->TASKS_STOPTX = 1;
+			state &= ~STATE_SENDING;
+		}
+	}
+	if (on) state |= STATE_DIRECT;
+	else state &= ~STATE_DIRECT;
+}
+
 static void console_printvalue(int value, int len)
 {
 	int c, d, sign=1;
@@ -225,7 +245,7 @@ static int parse_hexstring(const char **argptr, u8 *buf, int maxlen)
 
 enum { 
 	CMD_MD=1, CMD_MR, CMD_MW, CMD_STACK,
-	CMD_DISC, CMD_WIPE, CMD_B58ENC
+	CMD_DISC, CMD_WIPE, CMD_B58ENC, CMD_BENCH, CMD_BIP32
 };
 
 static const char cmdlist[] = {
@@ -237,6 +257,8 @@ static const char cmdlist[] = {
 	'd', 'i', 's', 'c', CMD_DISC,
 	'w','i','p','e', CMD_WIPE,
 	'b','5','8','e','n','c', CMD_B58ENC,
+	'b','e','n','c','h', CMD_BENCH,
+	'b','i','p','3','2', CMD_BIP32,
 	0
 
 };
@@ -302,6 +324,20 @@ void exec_cmd(int cmd, const char *args)
 			bool res = b58enc(tbuf, &tbufsz, hbuf, len);
 			break;
 		}
+
+		case CMD_BENCH:
+			bench_run(args);
+			break;
+
+		case CMD_BIP32:
+		{
+#if USE_BIP32_CACHE
+			const bip32_cache_stats *st = bip32_cache_get_stats();
+			dprintf("node hits %d misses %d, pubkey hits %d misses %d\n",
+				st->hits, st->misses, st->pubkey_hits, st->pubkey_misses);
+#endif
+			break;
+		}
 	}
 	dprintf("%% ");
 }
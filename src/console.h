@@ -27,6 +27,7 @@ void console_init(void);
 void console_tx(char c);
 void dprintf(char *fmt, ...);
 void console_read(console_input_cb cb);
+void console_direct(bool on);
 
 #else
 
@@ -35,6 +36,7 @@ void console_read(console_input_cb cb);
 #define dprintf(fmt...)
 #define console_tx(c)
 #define console_read(cb)
+#define console_direct(on)
 
 #endif
 
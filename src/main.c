@@ -2,6 +2,7 @@
 #include "types.pb.h"
 #include "messages.pb.h"
 #include "dialog.h"
+#include "storage.h"
 
 void* __initial_sp __attribute__((at(RAM_START+RAM_SIZE-4)));
 uint32_t __stack_array[STACK_SIZE/4-1]  __attribute__((at(RAM_START+RAM_SIZE-STACK_SIZE)));
@@ -191,7 +192,10 @@ int main(void)
 	ui_init();
 
 	while (1) {
-		ble_wait_event();
+		// background work only runs while no BLE event is pending
+		if (ble_check_event() != NRF_SUCCESS && ! session_prewarm()) {
+			ble_wait_event();
+		}
 		if (CurrentTime >= PoweroffTime) poweroff();
 	}
 }
@@ -30,6 +30,7 @@
 #include "sound.h"
 #include "random.h"
 #include "util.h"
+#include "bench.h"
 
 #define DBG(...) dprintf(__VA_ARGS__)
 
@@ -1,24 +1,20 @@
 #ifndef _SHA_H_
 #define _SHA_H_
 #include <stdint.h>
+#include "sha2.h"
 
 #define METHOD_SHA1   1
 #define METHOD_SHA256 2
 
+// the hashing itself is done by trezor-crypto (sha2.c), hashsize tells
+// which of the two contexts is in use
 struct sha_ctx
 {
 	int hashsize;
-	void (*transform)(struct sha_ctx *, uint32_t []);
-	uint32_t state[8];
-	uint8_t data[64];
-	uint32_t datalen;
-};
-
-struct sha_initial_ctx
-{
-	int hashsize;
-	void (*transform)(struct sha_ctx *, uint32_t []);
-	uint32_t state[8];
+	union {
+		SHA1_CTX sha1;
+		SHA256_CTX sha256;
+	};
 };
 
 struct hmac_data